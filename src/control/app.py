@@ -20,6 +20,8 @@ from typing import Any, Dict, List, Tuple
 
 from flask import Flask, jsonify, render_template, request
 
+from gpu_telemetry import GpuTelemetryWriter
+
 BASE_DIR = os.path.dirname(os.path.abspath(__file__))
 
 
@@ -86,6 +88,9 @@ def load_control_config() -> Dict[str, Any]:
     cfg.setdefault("auto_sync_interval_sec", 2)   # 文件变化轮询间隔
     cfg.setdefault("runtime_ttl_sec", 15)         # runtime 多久没上报就自动禁用（<=0 表示关闭）
 
+    # GPU 遥测共享内存（数据面无锁读取；置空表示关闭）
+    cfg.setdefault("gpu_telemetry_shm_path", "/dev/shm/ai_gateway_gpu_telemetry")
+
     return cfg
 
 
@@ -93,6 +98,27 @@ CFG = load_control_config()
 app = Flask(__name__, template_folder=abspath("templates"), static_folder=abspath("static"))
 
 
+# ------------------------- GPU 遥测共享内存 -------------------------
+
+_telemetry_writer = None
+_telemetry_lock = Lock()
+
+
+def publish_gpu_telemetry(ip: str, port: int, gpu: Any, vram: Any):
+    """把 GPU 数据写入共享内存遥测区；未配置、数据缺失或写入失败时静默跳过。"""
+    global _telemetry_writer
+    path = CFG.get("gpu_telemetry_shm_path")
+    if not path or gpu is None or vram is None:
+        return
+    with _telemetry_lock:
+        try:
+            if _telemetry_writer is None:
+                _telemetry_writer = GpuTelemetryWriter(path)
+            _telemetry_writer.publish(ip, port, float(gpu), float(vram))
+        except Exception as e:
+            print(f"[control] gpu telemetry publish failed: {e}")
+
+
 # ------------------------- 与代理进程交互（SIGHUP） -------------------------
 
 def try_reload_proxy() -> Tuple[bool, str]:
@@ -363,6 +389,8 @@ def api_register():
             }
         )
 
+    publish_gpu_telemetry(ip, port, gpu, vram)
+
     rt_obj["updated_at"] = now
     rt_obj["backends"] = rt_list
     write_json_atomic(CFG["runtime_backends_path"], rt_obj)
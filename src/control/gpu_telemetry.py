@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+GPU 遥测共享内存写者（控制面 / 节点 Agent 侧）
+
+与 C++ 数据面 src/logic/src/common/gpu_telemetry.h 共用同一块 /dev/shm 区域：
+- 头部 64 字节：magic, version, slot_count, slot_size
+- 每个后端一个 64 字节槽位，由 seqlock 保护（写前 seq 变奇数，写后变偶数）
+负载均衡器每次选择时无锁读取，GPU 数据更新不再需要重写 proxy_config.json + SIGHUP。
+
+约定：每个槽位同一时刻只有一个写者（同一个 ip:port 只由一个进程上报）。
+多个写者进程共用一个区域：初始化头部和认领空槽位在区域文件的 flock 排他锁内进行，
+两个进程不会认领到同一个空槽位；已认领槽位的数据更新不加锁，只走 seqlock。
+
+用法（一次性写入，调试用）：
+  python3 gpu_telemetry.py --ip 10.0.0.13 --port 9000 --gpu 0.4 --vram 0.7
+"""
+import argparse
+import fcntl
+import mmap
+import os
+import struct
+import time
+
+DEFAULT_PATH = "/dev/shm/ai_gateway_gpu_telemetry"
+MAGIC = 0x54555047  # "GPUT"
+VERSION = 1
+HEADER_SIZE = 64
+SLOT_SIZE = 64
+DEFAULT_SLOTS = 256
+
+# 槽位字段偏移（与 GpuTelemetrySlot 保持一致）
+OFF_SEQ = 0
+OFF_PORT = 4
+OFF_IP = 8
+IP_LEN = 40
+OFF_GPU = 48
+OFF_VRAM = 52
+OFF_UPDATED = 56
+
+
+class GpuTelemetryWriter:
+    def __init__(self, path: str = DEFAULT_PATH, slots: int = DEFAULT_SLOTS):
+        # fd 保持打开：初始化头部、认领槽位时要对它加 flock
+        self.fd = os.open(path, os.O_RDWR | os.O_CREAT, 0o644)
+        try:
+            fcntl.flock(self.fd, fcntl.LOCK_EX)
+            try:
+                self.slot_count = self._map_region(HEADER_SIZE + slots * SLOT_SIZE)
+            finally:
+                fcntl.flock(self.fd, fcntl.LOCK_UN)
+        except BaseException:
+            os.close(self.fd)
+            raise
+        self.slot_index = {}  # "ip:port" -> 槽位下标
+
+    def _map_region(self, size: int) -> int:
+        """映射区域并在需要时初始化头部（持锁调用），返回槽位数。"""
+        if os.fstat(self.fd).st_size < size:
+            os.ftruncate(self.fd, size)
+        size = os.fstat(self.fd).st_size
+        self.mm = mmap.mmap(self.fd, size, mmap.MAP_SHARED, mmap.PROT_READ | mmap.PROT_WRITE)
+
+        magic, version, slot_count, slot_size = struct.unpack_from("<IIII", self.mm, 0)
+        if magic != MAGIC:
+            # 新建区域：先写槽位数，最后写 magic，读者看到 magic 时头部已完整
+            slot_count = (size - HEADER_SIZE) // SLOT_SIZE
+            struct.pack_into("<III", self.mm, 4, VERSION, slot_count, SLOT_SIZE)
+            struct.pack_into("<I", self.mm, 0, MAGIC)
+        elif version != VERSION or slot_size != SLOT_SIZE:
+            self.mm.close()
+            raise RuntimeError(f"telemetry layout mismatch: version={version} slot_size={slot_size}")
+        return slot_count
+
+    def _slot_offset(self, i: int) -> int:
+        return HEADER_SIZE + i * SLOT_SIZE
+
+    def _find_or_claim(self, ip: str, port: int) -> int:
+        key = f"{ip}:{port}"
+        if key in self.slot_index:
+            return self.slot_index[key]
+
+        # 查找和认领整体在排他锁内：否则两个写者可能同时看到同一个空槽位，各自写入后互相覆盖
+        fcntl.flock(self.fd, fcntl.LOCK_EX)
+        try:
+            index = self._find_or_claim_locked(ip, port)
+        finally:
+            fcntl.flock(self.fd, fcntl.LOCK_UN)
+        self.slot_index[key] = index
+        return index
+
+    def _find_or_claim_locked(self, ip: str, port: int) -> int:
+        ip_bytes = ip.encode("ascii")[: IP_LEN - 1]
+        free = -1
+        for i in range(self.slot_count):
+            off = self._slot_offset(i)
+            slot_port = struct.unpack_from("<H", self.mm, off + OFF_PORT)[0]
+            if slot_port == 0:
+                if free < 0:
+                    free = i
+                continue
+            slot_ip = bytes(self.mm[off + OFF_IP: off + OFF_IP + IP_LEN]).split(b"\0", 1)[0]
+            if slot_port == port and slot_ip == ip_bytes:
+                return i
+
+        if free < 0:
+            raise RuntimeError("telemetry region is full")
+        # 认领空槽位：IP 和端口同样在 seqlock 内写入，读者不会看到写了一半的 IP；
+        # 端口最后写（端口非 0 即表示槽位已占用）
+        off = self._slot_offset(free)
+        seq = struct.unpack_from("<I", self.mm, off + OFF_SEQ)[0]
+        if seq & 1:
+            seq += 1
+        struct.pack_into("<I", self.mm, off + OFF_SEQ, (seq + 1) & 0xFFFFFFFF)
+        self.mm[off + OFF_IP: off + OFF_IP + IP_LEN] = ip_bytes.ljust(IP_LEN, b"\0")
+        struct.pack_into("<H", self.mm, off + OFF_PORT, port)
+        struct.pack_into("<I", self.mm, off + OFF_SEQ, (seq + 2) & 0xFFFFFFFF)
+        return free
+
+    def publish(self, ip: str, port: int, gpu_usage: float, vram_usage: float):
+        """seqlock 写入一个后端的 GPU 数据。"""
+        off = self._slot_offset(self._find_or_claim(ip, int(port)))
+        seq = struct.unpack_from("<I", self.mm, off + OFF_SEQ)[0]
+        if seq & 1:
+            seq += 1  # 上一个写者中途退出留下的奇数，先修正
+        struct.pack_into("<I", self.mm, off + OFF_SEQ, (seq + 1) & 0xFFFFFFFF)
+        struct.pack_into("<ffQ", self.mm, off + OFF_GPU,
+                         float(gpu_usage), float(vram_usage), int(time.time() * 1000))
+        struct.pack_into("<I", self.mm, off + OFF_SEQ, (seq + 2) & 0xFFFFFFFF)
+
+    def close(self):
+        self.mm.close()
+        os.close(self.fd)
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("--path", default=DEFAULT_PATH)
+    ap.add_argument("--ip", required=True)
+    ap.add_argument("--port", type=int, required=True)
+    ap.add_argument("--gpu", type=float, required=True)
+    ap.add_argument("--vram", type=float, required=True)
+    args = ap.parse_args()
+
+    writer = GpuTelemetryWriter(args.path)
+    writer.publish(args.ip, args.port, args.gpu, args.vram)
+    writer.close()
+    print(f"[telemetry] {args.ip}:{args.port} gpu={args.gpu} vram={args.vram} -> {args.path}")
+
+
+if __name__ == "__main__":
+    main()
@@ -2,8 +2,11 @@
 # -*- coding: utf-8 -*-
 """
 模拟后端周期上报 /api/register（用于 Step3 演示）
+--shm：GPU 数据改为高频写入共享内存遥测区（节点 Agent 模式），/api/register 只按 --interval 保活
 """
-import argparse, json, random, time, urllib.request
+import argparse, json, os, random, sys, time, urllib.request
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
 
 def post_json(url, payload):
     data = json.dumps(payload).encode("utf-8")
@@ -17,8 +20,25 @@ def main():
     ap.add_argument("--ip", default="10.0.0.13")
     ap.add_argument("--port", type=int, default=9000)
     ap.add_argument("--interval", type=int, default=3)
+    ap.add_argument("--shm", default="", help="GPU 遥测共享内存路径，如 /dev/shm/ai_gateway_gpu_telemetry")
+    ap.add_argument("--shm-interval", type=float, default=0.5)
     args = ap.parse_args()
 
+    if args.shm:
+        from gpu_telemetry import GpuTelemetryWriter
+        writer = GpuTelemetryWriter(args.shm)
+        last_register = 0.0
+        while True:
+            gpu = max(0.0, min(1.0, random.gauss(0.5, 0.2)))
+            vram = max(0.0, min(1.0, random.gauss(0.6, 0.2)))
+            writer.publish(args.ip, args.port, gpu, vram)
+            if time.time() - last_register >= args.interval:
+                payload = {"ip": args.ip, "port": args.port, "weight": 10}
+                out = post_json(args.base + "/api/register", payload)
+                print("[register]", payload, "->", out[:120], "...")
+                last_register = time.time()
+            time.sleep(args.shm_interval)
+
     while True:
         gpu = max(0.0, min(1.0, random.gauss(0.5, 0.2)))
         vram = max(0.0, min(1.0, random.gauss(0.6, 0.2)))
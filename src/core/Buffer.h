@@ -0,0 +1,121 @@
+// Buffer.h
+#pragma once
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include "MemoryManager.h"
+
+// 连接级缓冲区：内存布局为 [已消费 | 可读数据 | 空闲空间]
+// 写不完的数据暂存在这里，等 EPOLLOUT 再继续发送
+class Buffer {
+public:
+    static const size_t kInitialSize = 4096;
+    static const size_t kMaxIdleCapacity = 64 * 1024; // 空闲时超过这个容量就缩回 kInitialSize
+
+    explicit Buffer(size_t initialSize = kInitialSize)
+        : buffer_(initialSize), readIndex_(0), writeIndex_(0) {}
+
+    size_t readableBytes() const { return writeIndex_ - readIndex_; }
+    const char* peek() const { return buffer_.data() + readIndex_; }
+
+    void append(const char* data, size_t len) {
+        ensureWritable(len);
+        std::copy(data, data + len, buffer_.begin() + writeIndex_);
+        writeIndex_ += len;
+    }
+
+    void retrieve(size_t len) {
+        if (len < readableBytes()) {
+            readIndex_ += len;
+        } else {
+            retrieveAll();
+        }
+    }
+
+    // 数据取空时顺带归还积压期间扩出来的大块内存，避免每个连接长期占着峰值容量
+    void retrieveAll() {
+        readIndex_ = 0;
+        writeIndex_ = 0;
+        if (buffer_.size() > kMaxIdleCapacity) {
+            std::vector<char>(kInitialSize).swap(buffer_);
+        }
+    }
+
+    size_t capacity() const { return buffer_.size(); }
+
+    std::string retrieveAllAsString() {
+        std::string result(peek(), readableBytes());
+        retrieveAll();
+        return result;
+    }
+
+    // 用一次 readv 从 fd 读数据：先填本缓冲的空闲空间，放不下的部分留在池化块链里，不再追加回来
+    // (追加会多拷贝一次，还可能让缓冲扩容)。*overflow 为留在 chain 里的字节数，调用方必须在
+    // 下一次 readFd 之前取走。返回读到的总字节数，0 表示对端关闭，-1 表示出错 (*savedErrno，含 EAGAIN)
+    ssize_t readFd(int fd, const PooledIoVec& chain, size_t* overflow, int* savedErrno) {
+        struct iovec vec[1 + PooledIoVec::kBlocks];
+        size_t writable = buffer_.size() - writeIndex_;
+        vec[0].iov_base = buffer_.data() + writeIndex_;
+        vec[0].iov_len = writable;
+        int iovcnt = 1 + chain.fill(vec + 1);
+
+        ssize_t n;
+        do {
+            n = ::readv(fd, vec, iovcnt);
+        } while (n < 0 && errno == EINTR);
+
+        *overflow = 0;
+        if (n < 0) {
+            *savedErrno = errno;
+        } else if (static_cast<size_t>(n) <= writable) {
+            writeIndex_ += n;
+        } else {
+            writeIndex_ = buffer_.size();
+            *overflow = n - writable;
+        }
+        return n;
+    }
+
+    // 把可读数据尽量写进 socket (非阻塞)，返回本次写出的字节数
+    // 返回 -1 时 *savedErrno 保存 errno，EAGAIN 表示对端太慢，需要等 EPOLLOUT
+    ssize_t writeFd(int fd, int* savedErrno) {
+        ssize_t total = 0;
+        while (readableBytes() > 0) {
+            // MSG_NOSIGNAL：对端已关闭时返回 EPIPE，而不是让整个进程被 SIGPIPE 杀掉
+            ssize_t n = ::send(fd, peek(), readableBytes(), MSG_NOSIGNAL);
+            if (n > 0) {
+                retrieve(static_cast<size_t>(n));
+                total += n;
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                *savedErrno = errno;
+                return total > 0 ? total : -1;
+            }
+        }
+        return total;
+    }
+
+private:
+    void ensureWritable(size_t len) {
+        if (buffer_.size() - writeIndex_ >= len) return;
+
+        size_t readable = readableBytes();
+        if (readIndex_ + (buffer_.size() - writeIndex_) >= len) {
+            // 前面已消费的空间够用：把数据挪到开头，避免无限扩容
+            std::copy(buffer_.begin() + readIndex_, buffer_.begin() + writeIndex_, buffer_.begin());
+            readIndex_ = 0;
+            writeIndex_ = readable;
+        } else {
+            buffer_.resize(writeIndex_ + len);
+        }
+    }
+
+    std::vector<char> buffer_;
+    size_t readIndex_;
+    size_t writeIndex_;
+};
@@ -8,9 +8,11 @@ class EpollPoller : public Poller {
 private:
     int epollfd_;
     std::vector<struct epoll_event> events_; // 存放内核返回的事件
+    bool edgeTriggered_;                     // 是否给所有 fd 加 EPOLLET
 
 public:
-    EpollPoller() : epollfd_(::epoll_create1(EPOLL_CLOEXEC)), events_(1024) {}
+    explicit EpollPoller(bool edgeTriggered = false)
+        : epollfd_(::epoll_create1(EPOLL_CLOEXEC)), events_(1024), edgeTriggered_(edgeTriggered) {}
     
     ~EpollPoller() { ::close(epollfd_); }
 
@@ -26,7 +28,7 @@ public:
                 activeChannels->push_back(channel);
             }
             // 自动扩容：如果事件太多装不下，下次把容器弄大点
-            if (numEvents == events_.size()) {
+            if (static_cast<size_t>(numEvents) == events_.size()) {
                 events_.resize(events_.size() * 2);
             }
         }
@@ -36,13 +38,31 @@ public:
         struct epoll_event event;
         memset(&event, 0, sizeof(event));
         event.events = channel->events;
+        if (edgeTriggered_) event.events |= EPOLLET;
         event.data.ptr = channel; // 关键：把 Channel 指针存进去
         
-        // 实际上这里要判断是 EPOLL_CTL_ADD 还是 MOD
-        ::epoll_ctl(epollfd_, EPOLL_CTL_ADD, channel->fd, &event);
+        // 根据注册状态区分 ADD 和 MOD：同一个 fd 重复 ADD 会返回 EEXIST，
+        // 写兴趣 (EPOLLOUT) 的开关必须走 MOD 才能生效
+        if (channel->index == kChannelNew) {
+            if (channel->exclusive) event.events |= EPOLLEXCLUSIVE;
+            ::epoll_ctl(epollfd_, EPOLL_CTL_ADD, channel->fd, &event);
+            channel->index = kChannelAdded;
+        } else if (channel->exclusive) {
+            // 内核不允许对 EPOLLEXCLUSIVE 的 fd 做 MOD，只能先删再加
+            event.events |= EPOLLEXCLUSIVE;
+            ::epoll_ctl(epollfd_, EPOLL_CTL_DEL, channel->fd, nullptr);
+            ::epoll_ctl(epollfd_, EPOLL_CTL_ADD, channel->fd, &event);
+        } else {
+            ::epoll_ctl(epollfd_, EPOLL_CTL_MOD, channel->fd, &event);
+        }
     }
 
     void removeChannel(Channel* channel) override {
-        ::epoll_ctl(epollfd_, EPOLL_CTL_DEL, channel->fd, nullptr);
+        if (channel->index == kChannelAdded) {
+            ::epoll_ctl(epollfd_, EPOLL_CTL_DEL, channel->fd, nullptr);
+        }
+        channel->index = kChannelNew;
     }
+
+    bool edgeTriggered() const override { return edgeTriggered_; }
 };
\ No newline at end of file
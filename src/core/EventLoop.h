@@ -1,19 +1,29 @@
 // EventLoop.h
 #pragma once
 #include "Poller.h"
+#include "Buffer.h"
+#include "MemoryManager.h"
 #include <vector>
+#include <string>
+#include <algorithm>
 #include <iostream>
 #include <unistd.h>
 #include <cstring>
 #include <queue>        // [Task 1] 引入队列
 #include <functional>   // [Task 1] 引入回调函数
 #include <mutex>        // [Task 1] 线程锁
+#include <fcntl.h>
+#include <sys/socket.h>
+
+// 任务处理完后把响应交回连接：明文连接直接写 fd，TLS 连接走 TlsConnection::send 加密
+using TaskReply = std::function<void(const std::string& response)>;
 
 // [Task 1] 定义一个任务结构体
 struct Task {
     int priority; // 优先级：1=高(VIP), 0=普通
     int fd;       // 连接描述符
     std::string data; // 读到的数据
+    TaskReply reply;  // 响应出口 (为空时只处理不回包)
 
     // 优先级队列的排序规则：priority 小的排后面 (我们希望 priority 大的排前面)
     bool operator<(const Task& other) const {
@@ -23,6 +33,8 @@ struct Task {
 
 class EventLoop {
 public:
+    static const size_t kMaxReadPerWakeup = 64 * 1024; // 边缘触发时单个连接每轮最多读这么多
+
     EventLoop() {
         poller_ = Poller::newDefaultPoller(); 
     }
@@ -34,50 +46,181 @@ public:
     // 核心工作循环
     void loop() {
         while (!quit_) {
-            std::vector<Channel*> activeChannels;
-            poller_->poll(5000, &activeChannels);
-
-            // --- 阶段 1: 接收 IO 事件并封装成任务 ---
-            for (auto channel : activeChannels) {
-                char buf[4096] = {0};
-                ssize_t n = ::read(channel->fd, buf, sizeof(buf) - 1);
-
-                if (n > 0) {
-                    std::string request(buf);
-                    
-                    // [Task 1] 核心逻辑：判断是否为 VIP
-                    int prio = 0; // 默认普通
-                    if (request.find("X-Priority: High") != std::string::npos) {
-                        prio = 1; // 标记为 VIP
-                        std::cout << "[Priority] 检测到 VIP 请求 (FD=" << channel->fd << ") -> 插队!" << std::endl;
-                    }
-
-                    // 将任务加入优先级队列
-                    {
-                        std::lock_guard<std::mutex> lock(mutex_);
-                        taskQueue_.push({prio, channel->fd, request});
-                    }
-
-                } else if (n == 0) {
-                    close(channel->fd);
-                    poller_->removeChannel(channel);
-                    delete channel;
+            loopOnce(5000);
+        }
+    }
+
+    // 跑一轮：等待事件 -> 处理 IO -> 执行任务 -> 执行延迟回调 (单元测试可直接逐轮驱动)
+    void loopOnce(int timeoutMs) {
+        // activeChannels_ 是成员变量，clear 只重置长度，不会每轮重新分配
+        activeChannels_.clear();
+        // 上一轮因读取配额没读完的连接不会再来新的边缘事件：本轮不等待，直接接着读
+        poller_->poll(pendingReads_.empty() ? timeoutMs : 0, &activeChannels_);
+        for (Channel* channel : pendingReads_) {
+            if (std::find(activeChannels_.begin(), activeChannels_.end(), channel) == activeChannels_.end()) {
+                channel->revents = EPOLLIN;
+                activeChannels_.push_back(channel);
+            }
+        }
+        pendingReads_.clear();
+
+        // --- 阶段 1: 接收 IO 事件并封装成任务 ---
+        for (auto channel : activeChannels_) {
+            // 注册了回调的 Channel (如流式转发) 直接分发，不进任务队列
+            if (channel->readCallback || channel->writeCallback) {
+                handleChannelEvent(channel);
+                continue;
+            }
+
+            bool peerClosed = false;
+            bool hasMore = false;
+            std::string request;
+            bool ok = readRequest(channel->fd, &request, &peerClosed, &hasMore);
+            bool closing = peerClosed || !ok;
+
+            if (!request.empty()) {
+                // 静态资源等能就地响应的请求直接处理，不进任务队列 (此后连接归处理方管理)
+                if (!closing && requestHandler_ && requestHandler_(channel, request)) continue;
+                // 连接在本轮就会被关掉时不能再回包 (fd 号可能已被新连接复用)
+                TaskReply reply;
+                if (!closing) {
+                    int fd = channel->fd;
+                    reply = [fd](const std::string& response) {
+                        ::send(fd, response.data(), response.size(), MSG_NOSIGNAL);
+                    };
                 }
+                enqueueTask(channel->fd, std::move(request), std::move(reply));
             }
 
-            // --- 阶段 2: 执行任务 (VIP 优先) ---
-            processPendingTasks();
+            if (closing) {
+                poller_->removeChannel(channel);
+                close(channel->fd);
+                delete channel;
+            } else if (hasMore) {
+                pendingReads_.push_back(channel);
+            }
         }
+
+        // --- 阶段 2: 执行任务 (VIP 优先) ---
+        processPendingTasks();
+
+        // --- 阶段 3: 执行延迟回调 (如释放本轮已关闭的连接对象) ---
+        doPendingFunctors();
     }
 
     void addConnection(int fd) {
         Channel* channel = new Channel();
         channel->fd = fd;
-        channel->events = 1; 
+        channel->events = EPOLLIN;
+        if (poller_->edgeTriggered()) {
+            // 边缘触发要求非阻塞 fd，否则读到 EAGAIN 之前会卡死在最后一次 read
+            int flags = ::fcntl(fd, F_GETFL, 0);
+            ::fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+        }
         poller_->updateChannel(channel);
     }
 
+    // 注册一个被多个 EventLoop 共享的监听 fd，新连接到达时调用 acceptCallback
+    // 打上 exclusive 标记：内核每次只唤醒其中一个 EventLoop，避免惊群
+    Channel* addListener(int listenFd, std::function<void()> acceptCallback) {
+        Channel* channel = new Channel();
+        channel->fd = listenFd;
+        channel->events = EPOLLIN;
+        channel->exclusive = true;
+        channel->readCallback = std::move(acceptCallback);
+        poller_->updateChannel(channel);
+        return channel;
+    }
+
+    // 在请求进入任务队列前先交给 handler，返回 true 表示已处理 (如 StaticFileServer)
+    // handler 接管后由它负责该 Channel 的后续读写或关闭
+    using RequestHandler = std::function<bool(Channel* channel, const std::string& request)>;
+    void setRequestHandler(RequestHandler handler) {
+        requestHandler_ = std::move(handler);
+    }
+
+    // [Task 1] 把一个请求放进优先级队列 (带 X-Priority: High 的 VIP 请求插队)
+    // 除了本循环直接读到的数据，TLS 等连接解密后的数据也从这里进入，reply 负责把响应按连接的协议发回。
+    // 任务在本轮的阶段 2 处理，早于阶段 3 的延迟释放：reply 捕获的连接对象在本轮内始终有效
+    void enqueueTask(int fd, std::string request, TaskReply reply = TaskReply()) {
+        // [Task 1] 核心逻辑：判断是否为 VIP
+        int prio = 0; // 默认普通
+        if (request.find("X-Priority: High") != std::string::npos) {
+            prio = 1; // 标记为 VIP
+            std::cout << "[Priority] 检测到 VIP 请求 (FD=" << fd << ") -> 插队!" << std::endl;
+        }
+
+        // 将任务加入优先级队列
+        std::lock_guard<std::mutex> lock(mutex_);
+        taskQueue_.push({prio, fd, std::move(request), std::move(reply)});
+    }
+
+    // 修改 Channel 的监听事件 (读写兴趣切换走 EPOLL_CTL_MOD)
+    void updateChannel(Channel* channel) {
+        poller_->updateChannel(channel);
+    }
+
+    void removeChannel(Channel* channel) {
+        poller_->removeChannel(channel);
+    }
+
+    // 把回调推迟到本轮事件处理结束后执行
+    // 本轮 activeChannels 里可能还有同一连接的另一个 Channel，不能在回调里直接 delete
+    void queueInLoop(std::function<void()> cb) {
+        std::lock_guard<std::mutex> lock(functorMutex_);
+        pendingFunctors_.push_back(std::move(cb));
+    }
+
 private:
+    // 把连接上已到达的数据读进 *request。水平触发只读一次 readv (没读完内核下一轮还会报)；
+    // 边缘触发读到 EAGAIN 为止，但单轮最多读 kMaxReadPerWakeup 字节，超出时置 *hasMore 留到下一轮，
+    // 一个大请求不会独占整轮。返回 false 表示连接出错
+    bool readRequest(int fd, std::string* request, bool* peerClosed, bool* hasMore) {
+        while (true) {
+            size_t overflow = 0;
+            int savedErrno = 0;
+            ssize_t n = inputBuffer_.readFd(fd, ioChain_, &overflow, &savedErrno);
+            if (n > 0) {
+                // 本缓冲和溢出块链直接拼进请求：每个字节只拷贝这一次，请求体里的 \0 也不会截断
+                request->append(inputBuffer_.peek(), inputBuffer_.readableBytes());
+                inputBuffer_.retrieveAll();
+                ioChain_.appendTo(request, overflow);
+                if (!poller_->edgeTriggered()) return true;
+                if (request->size() >= kMaxReadPerWakeup) {
+                    *hasMore = true;
+                    return true;
+                }
+            } else if (n == 0) {
+                *peerClosed = true;
+                return true;
+            } else {
+                return savedErrno == EAGAIN || savedErrno == EWOULDBLOCK;
+            }
+        }
+    }
+
+    // 按实际发生的事件分发读/写回调
+    void handleChannelEvent(Channel* channel) {
+        int revents = channel->revents;
+        if ((revents & (EPOLLIN | EPOLLPRI | EPOLLHUP | EPOLLERR)) && channel->readCallback) {
+            channel->readCallback();
+        }
+        if ((revents & EPOLLOUT) && channel->writeCallback) {
+            channel->writeCallback();
+        }
+    }
+
+    void doPendingFunctors() {
+        std::vector<std::function<void()>> functors;
+        {
+            std::lock_guard<std::mutex> lock(functorMutex_);
+            functors.swap(pendingFunctors_);
+        }
+        for (auto& functor : functors) {
+            functor();
+        }
+    }
+
     // [Task 1] 处理积压的任务
     void processPendingTasks() {
         std::lock_guard<std::mutex> lock(mutex_);
@@ -91,14 +234,32 @@ private:
             std::cout << "[Worker] 执行任务 FD=" << task.fd 
                       << " | 级别: " << (task.priority == 1 ? "★ VIP ★" : "普通") 
                       << " | 内容: " << task.data.substr(0, 10) << "..." << std::endl;
+
+            if (task.reply) {
+                static const std::string kAccepted = "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n"
+                                                     "Content-Length: 26\r\n\r\nAI Gateway: task accepted\n";
+                task.reply(kAccepted);
+            }
         }
     }
 
 private:
     Poller* poller_;
     bool quit_ = false;
+
+    // [读路径优化] 每轮复用的活跃 Channel 列表、输入缓冲和 readv 池化块链
+    std::vector<Channel*> activeChannels_;
+    Buffer inputBuffer_;
+    PooledIoVec ioChain_;
+    std::vector<Channel*> pendingReads_; // 边缘触发下达到读取配额、还有数据没读完的连接
+
+    RequestHandler requestHandler_;
     
     // [Task 1] 优先级队列 (自动排序)
     std::priority_queue<Task> taskQueue_;
     std::mutex mutex_;
+
+    // 延迟回调队列
+    std::vector<std::function<void()>> pendingFunctors_;
+    std::mutex functorMutex_;
 };
\ No newline at end of file
@@ -1,6 +1,8 @@
 // MemoryManager.h
 #pragma once
 #include <vector>
+#include <string>
+#include <algorithm>
 #include <mutex>
 #include <atomic>
 #include <iostream>
@@ -8,18 +10,30 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <cstring>
+#include <sys/uio.h>
+#include <poll.h>
+#include <errno.h>
 
 // [得分点：内存使用监控]
 // 原子变量，统计当前分配的字节数
-static std::atomic<long> g_memory_usage(0);
+inline std::atomic<long> g_memory_usage(0);
 
 // [得分点：内存池设计 (Slab分配器 - 降维版)]
 class MemoryPool {
 public:
     static const int BLOCK_SIZE = 4096; 
 
-    // 申请内存
+    static const size_t LOCAL_CACHE_LIMIT = 256; // 每个线程本地最多缓存的块数 (1MB)
+
+    // 申请内存：优先取当前线程的本地缓存 (无锁，且是本线程 first-touch 出来的 NUMA 本地内存)
     static char* allocate() {
+        if (!local_.blocks.empty()) {
+            char* ptr = local_.blocks.back();
+            local_.blocks.pop_back();
+            return ptr;
+        }
+
         std::lock_guard<std::mutex> lock(mutex_);
         if (!free_list_.empty()) {
             char* ptr = free_list_.back();
@@ -31,12 +45,27 @@ public:
         return new char[BLOCK_SIZE];
     }
 
-    // 归还内存
+    // 归还内存：本地缓存没满就留在本线程，满了再还给全局链表
     static void deallocate(char* ptr) {
+        if (local_.blocks.size() < LOCAL_CACHE_LIMIT) {
+            local_.blocks.push_back(ptr);
+            return;
+        }
         std::lock_guard<std::mutex> lock(mutex_);
         free_list_.push_back(ptr);
     }
 
+    // [NUMA] 在已绑核的 Worker 线程里调用：预先申请并写一遍 count 个块
+    // Linux 按 first-touch 分配物理页，所以这些块会落在该 Worker 所在的 NUMA 节点上
+    static void prefaultLocal(size_t count) {
+        for (size_t i = 0; i < count && local_.blocks.size() < LOCAL_CACHE_LIMIT; ++i) {
+            char* ptr = new char[BLOCK_SIZE];
+            memset(ptr, 0, BLOCK_SIZE);
+            g_memory_usage += BLOCK_SIZE;
+            local_.blocks.push_back(ptr);
+        }
+    }
+
     // ============================================
     // 【关键修复】 补上了这个缺失的函数
     // ============================================
@@ -45,28 +74,124 @@ public:
     }
 
 private:
-    static std::vector<char*> free_list_;
-    static std::mutex mutex_;
+    // inline 静态成员 (C++17)：头文件被多个 .cpp 包含时也只有一份定义
+    inline static std::vector<char*> free_list_;
+    inline static std::mutex mutex_;
+
+    // 线程本地缓存：线程退出时把剩余的块还给全局链表
+    struct LocalCache {
+        std::vector<char*> blocks;
+        ~LocalCache() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            free_list_.insert(free_list_.end(), blocks.begin(), blocks.end());
+        }
+    };
+    inline static thread_local LocalCache local_;
 };
 
-// 静态成员初始化
-std::vector<char*> MemoryPool::free_list_;
-std::mutex MemoryPool::mutex_;
+// [读路径优化] 一串常驻的池化内存块，作为 readv 的 iovec 链反复使用
+// 每个 EventLoop 持有一份，读大包时溢出到这里，不用每次事件都新开缓冲
+class PooledIoVec {
+public:
+    static const int kBlocks = 4; // 4 x 4KB，一次 readv 最多多收 16KB
+
+    PooledIoVec() {
+        for (int i = 0; i < kBlocks; ++i) blocks_[i] = MemoryPool::allocate();
+    }
+
+    ~PooledIoVec() {
+        for (int i = 0; i < kBlocks; ++i) MemoryPool::deallocate(blocks_[i]);
+    }
+
+    PooledIoVec(const PooledIoVec&) = delete;
+    PooledIoVec& operator=(const PooledIoVec&) = delete;
+
+    // 把池化块依次填进 iov，返回填入的个数
+    int fill(struct iovec* iov) const {
+        for (int i = 0; i < kBlocks; ++i) {
+            iov[i].iov_base = blocks_[i];
+            iov[i].iov_len = MemoryPool::BLOCK_SIZE;
+        }
+        return kBlocks;
+    }
+
+    const char* block(int i) const { return blocks_[i]; }
+
+    // 把 readv 溢出到块链里的前 len 字节直接追加到 out (块链在下一次 readv 前有效)
+    void appendTo(std::string* out, size_t len) const {
+        for (int i = 0; i < kBlocks && len > 0; ++i) {
+            size_t take = std::min(len, static_cast<size_t>(MemoryPool::BLOCK_SIZE));
+            out->append(blocks_[i], take);
+            len -= take;
+        }
+    }
+
+private:
+    char* blocks_[kBlocks];
+};
 
 // [得分点：零拷贝技术]
 class TransferUtils {
 public:
-    static ssize_t sendFileZeroCopy(int out_socket_fd, const char* filename) {
-        int in_file_fd = open(filename, O_RDONLY);
+    // 从 *offset 开始把 count 字节直接从文件送进 socket，短写时接着发，
+    // 直到发完、socket 缓冲写满 (EAGAIN) 或出错为止；*offset 随已发送的字节前进。
+    // 返回本次发送的字节数；没发完时 *savedErrno 记录原因 (文件被截断导致提前结束时为 0)，
+    // 非阻塞 socket 遇到 EAGAIN 由调用方在 EPOLLOUT 后用同一个 offset 接着调用
+    static ssize_t sendFileRange(int out_socket_fd, int in_file_fd, off_t* offset, size_t count,
+                                 int* savedErrno) {
+        ssize_t total = 0;
+        *savedErrno = 0;
+        while (static_cast<size_t>(total) < count) {
+            ssize_t n = sendfile(out_socket_fd, in_file_fd, offset, count - total);
+            if (n > 0) {
+                total += n;
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) *savedErrno = errno;
+            break; // n == 0：文件比预期短
+        }
+        return total;
+    }
+
+    // 整个文件一次发完：阻塞 socket 上循环到发完为止，非阻塞 socket 遇到 EAGAIN 时等待可写再继续
+    // 每次等待最多 timeoutMs 毫秒：对端一直不收 (慢客户端 / 对端卡死) 时放弃，返回 -1 且 errno = ETIMEDOUT
+    static ssize_t sendFileZeroCopy(int out_socket_fd, const char* filename, int timeoutMs = 30000) {
+        int in_file_fd = open(filename, O_RDONLY | O_CLOEXEC);
         if (in_file_fd < 0) return -1;
 
         struct stat stat_buf;
-        fstat(in_file_fd, &stat_buf);
+        if (fstat(in_file_fd, &stat_buf) < 0) {
+            close(in_file_fd);
+            return -1;
+        }
 
         off_t offset = 0;
-        ssize_t sent_bytes = sendfile(out_socket_fd, in_file_fd, &offset, stat_buf.st_size);
+        size_t remaining = stat_buf.st_size;
+        int savedErrno = 0;
+        while (remaining > 0) {
+            ssize_t n = sendFileRange(out_socket_fd, in_file_fd, &offset, remaining, &savedErrno);
+            remaining -= n;
+            if (remaining == 0) break;
+            if (savedErrno != EAGAIN && savedErrno != EWOULDBLOCK) break;
+
+            struct pollfd pfd;
+            pfd.fd = out_socket_fd;
+            pfd.events = POLLOUT;
+            int ready = poll(&pfd, 1, timeoutMs);
+            if (ready == 0) {
+                savedErrno = ETIMEDOUT;
+                break;
+            }
+            if (ready < 0 && errno != EINTR) {
+                savedErrno = errno;
+                break;
+            }
+        }
 
         close(in_file_fd);
-        return sent_bytes;
+        if (remaining == 0) return static_cast<ssize_t>(offset);
+        errno = savedErrno ? savedErrno : EIO; // 0 表示文件在发送中被截断
+        return -1;
     }
-};
\ No newline at end of file
+};
@@ -14,6 +14,6 @@ Poller* Poller::newDefaultPoller() {
         return new SelectPoller();
     }
     
-    // 默认使用 Epoll (生产级)
-    return new EpollPoller();
+    // 默认使用 Epoll (生产级)，USE_EPOLL_ET 开启边缘触发
+    return new EpollPoller(::getenv("USE_EPOLL_ET") != nullptr);
 }
\ No newline at end of file
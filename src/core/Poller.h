@@ -2,12 +2,32 @@
 #pragma once
 #include <vector>
 #include <map>
+#include <functional>
+#include <sys/epoll.h>
+
+// Channel 在 Poller 中的注册状态，用来区分 EPOLL_CTL_ADD / MOD / DEL
+const int kChannelNew = -1;     // 从未加入过 Poller
+const int kChannelAdded = 1;    // 已经在 Poller 中监听
 
 // 前置声明：Channel 是对 socket 的封装，包含 fd 和感兴趣的事件（读/写）
 struct Channel {
     int fd;
     int events;      // 你希望监听的事件 (如 EPOLLIN, EPOLLOUT)
     int revents;     // 实际发生的事件
+    int index = kChannelNew; // Poller 内部使用的注册状态
+    bool exclusive = false;  // 多个 EventLoop 共享的监听 fd：用 EPOLLEXCLUSIVE 避免惊群
+
+    // 事件回调：设置了回调的 Channel 由 EventLoop 直接分发，不走任务队列
+    std::function<void()> readCallback;
+    std::function<void()> writeCallback;
+
+    // 读写兴趣开关（背压控制的核心：输出缓冲有数据时才关注 EPOLLOUT）
+    void enableReading()  { events |= EPOLLIN; }
+    void disableReading() { events &= ~EPOLLIN; }
+    void enableWriting()  { events |= EPOLLOUT; }
+    void disableWriting() { events &= ~EPOLLOUT; }
+    bool isReading() const { return events & EPOLLIN; }
+    bool isWriting() const { return events & EPOLLOUT; }
 };
 
 // 抽象基类
@@ -26,6 +46,9 @@ public:
     // 核心接口 3：移除事件 (不再监听)
     virtual void removeChannel(Channel* channel) = 0;
 
+    // 是否为边缘触发：是的话调用方必须把 fd 读/写到 EAGAIN 为止
+    virtual bool edgeTriggered() const { return false; }
+
     // 静态工厂方法：根据配置生产具体的 Poller
     static Poller* newDefaultPoller(); 
-};
\ No newline at end of file
+};
@@ -0,0 +1,222 @@
+// StreamRelay.h
+#pragma once
+#include "EventLoop.h"
+#include "Buffer.h"
+#include <string>
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+// 客户端 <-> 后端 的双向流式转发 (SSE / chunked 逐块透传)
+// 每读到一块数据立即转发，不攒完整响应；写不完的部分进入对端输出缓冲，
+// 由 EPOLLOUT 驱动继续发送。对端缓冲超过高水位时暂停读取来源 fd，
+// 回落到低水位以下再恢复，保证慢客户端不会让内存无限增长。
+// 客户端先关闭写方向 (半关闭) 时，积压的请求数据发完后对后端 shutdown(SHUT_WR)，
+// 后端的响应继续转发给客户端；后端读到 EOF 且客户端缓冲写空后才整体关闭。
+//
+// 用法：(new StreamRelay(loop, clientFd, backendFd))->start(已读到的请求);
+// 连接关闭后对象在 EventLoop 的延迟回调中自行释放。
+class StreamRelay {
+public:
+    static const size_t kHighWaterMark = 256 * 1024; // 超过即暂停读取来源 fd
+    static const size_t kLowWaterMark = 64 * 1024;   // 回落到此以下恢复读取
+    static const size_t kHeaderProbeLimit = 8192;    // 识别流式响应时最多检查的响应头字节数
+
+    StreamRelay(EventLoop* loop, int clientFd, int backendFd)
+        : loop_(loop), closed_(false), headerChecked_(false) {
+        client_.channel.fd = clientFd;
+        backend_.channel.fd = backendFd;
+    }
+
+    // pendingToBackend：接管连接前已经从客户端读出的数据 (通常是第一个请求)，先发给后端。
+    // 后端 fd 可以是尚未连接完成的非阻塞 socket，连接建立后由 EPOLLOUT 把它发出去
+    void start(const std::string& pendingToBackend = std::string()) {
+        setupSide(client_, backend_);
+        setupSide(backend_, client_);
+        if (!pendingToBackend.empty()) {
+            backend_.output.append(pendingToBackend.data(), pendingToBackend.size());
+            backend_.channel.enableWriting();
+        }
+        loop_->updateChannel(&client_.channel);
+        loop_->updateChannel(&backend_.channel);
+    }
+
+    // 等待写给客户端的字节数 / 是否因背压暂停读取后端 (监控与测试用)
+    size_t pendingToClient() const { return client_.output.readableBytes(); }
+    bool backendReadPaused() const { return !backend_.readClosed && !backend_.channel.isReading(); }
+
+private:
+    // 一个方向的端点：output 是等待写入该 fd 的数据
+    struct Side {
+        Channel channel;
+        Buffer output;
+        bool readClosed = false; // 该 fd 已读到 EOF
+        bool writeShut = false;  // 已对该 fd 做过 shutdown(SHUT_WR)
+    };
+
+    void setupSide(Side& self, Side& peer) {
+        int flags = ::fcntl(self.channel.fd, F_GETFL, 0);
+        ::fcntl(self.channel.fd, F_SETFL, flags | O_NONBLOCK);
+
+        self.channel.events = EPOLLIN;
+        self.channel.readCallback = [this, &self, &peer]() { handleRead(self, peer); };
+        self.channel.writeCallback = [this, &self, &peer]() { handleWrite(self, peer); };
+    }
+
+    // from 可读：读出数据后立即转发给 to
+    void handleRead(Side& from, Side& to) {
+        if (closed_) return;
+        if (!from.channel.isReading()) {
+            // 暂停读取期间仍会收到 EPOLLHUP/EPOLLERR：出错直接关闭；
+            // 挂断则先摘掉监听避免水平触发空转，恢复读取时 updateChannel 会重新 ADD
+            if (from.channel.revents & EPOLLERR) {
+                shutdown();
+            } else {
+                loop_->removeChannel(&from.channel);
+            }
+            return;
+        }
+
+        char buf[16384];
+        while (true) {
+            ssize_t n = ::read(from.channel.fd, buf, sizeof(buf));
+            if (n > 0) {
+                if (&from == &backend_ && !headerChecked_) {
+                    probeStreamingHeader(buf, static_cast<size_t>(n));
+                }
+                if (!forward(to, buf, static_cast<size_t>(n))) return;
+
+                // [背压] 对端积压过多：暂停读取来源，剩余数据留在内核 socket 缓冲里
+                if (to.output.readableBytes() >= kHighWaterMark) {
+                    from.channel.disableReading();
+                    loop_->updateChannel(&from.channel);
+                    std::cout << "[Backpressure] FD=" << to.channel.fd << " 积压 "
+                              << to.output.readableBytes() << " 字节，暂停读取 FD="
+                              << from.channel.fd << std::endl;
+                    return;
+                }
+            } else if (n == 0) {
+                from.readClosed = true;
+                from.channel.disableReading();
+                loop_->updateChannel(&from.channel);
+                // 数据已全部送达才往下传递 EOF，否则等 to 的缓冲写空后再处理
+                if (to.output.readableBytes() == 0) onPeerDrained(to);
+                return;
+            } else {
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) shutdown();
+                return;
+            }
+        }
+    }
+
+    // side 可写：继续发送积压数据
+    void handleWrite(Side& side, Side& peer) {
+        if (closed_ || !side.channel.isWriting()) return;
+
+        int savedErrno = 0;
+        ssize_t n = side.output.writeFd(side.channel.fd, &savedErrno);
+        if (n < 0 && savedErrno != EAGAIN && savedErrno != EWOULDBLOCK) {
+            shutdown();
+            return;
+        }
+
+        if (side.output.readableBytes() == 0) {
+            side.channel.disableWriting(); // 写空后立即关闭写兴趣，避免 EPOLLOUT 空转
+            loop_->updateChannel(&side.channel);
+            if (peer.readClosed) {
+                onPeerDrained(side);
+                return;
+            }
+        }
+
+        // [背压] 积压回落到低水位以下，恢复读取来源
+        if (side.output.readableBytes() < kLowWaterMark && !peer.readClosed && !peer.channel.isReading()) {
+            peer.channel.enableReading();
+            loop_->updateChannel(&peer.channel);
+        }
+    }
+
+    // side 的对端已读到 EOF，且发往 side 的数据已全部写出：
+    // - 后端 EOF：响应已完整送达客户端，整体关闭
+    // - 客户端 EOF (半关闭)：只关闭到后端的写方向，让后端看到请求结束，继续等它的响应
+    void onPeerDrained(Side& side) {
+        if (&side == &client_) {
+            shutdown();
+            return;
+        }
+        if (!side.writeShut) {
+            side.writeShut = true;
+            ::shutdown(side.channel.fd, SHUT_WR);
+            std::cout << "[Stream] FD=" << client_.channel.fd << " 客户端半关闭，已关闭到后端 FD="
+                      << side.channel.fd << " 的写方向" << std::endl;
+        }
+    }
+
+    // 缓冲为空时直接写 socket，写不完的部分再进缓冲 (首个 token 不经过额外拷贝)
+    bool forward(Side& to, const char* data, size_t len) {
+        size_t written = 0;
+        if (to.output.readableBytes() == 0) {
+            ssize_t n = ::send(to.channel.fd, data, len, MSG_NOSIGNAL);
+            if (n > 0) {
+                written = static_cast<size_t>(n);
+            } else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                shutdown();
+                return false;
+            }
+        }
+
+        if (written < len) {
+            to.output.append(data + written, len - written);
+            if (!to.channel.isWriting()) {
+                to.channel.enableWriting();
+                loop_->updateChannel(&to.channel);
+            }
+        }
+        return true;
+    }
+
+    // 检查后端响应头：SSE 或 chunked 响应关闭客户端的 Nagle，token 到了立刻发出
+    void probeStreamingHeader(const char* data, size_t len) {
+        headerProbe_.append(data, std::min(len, kHeaderProbeLimit - headerProbe_.size()));
+        size_t headerEnd = headerProbe_.find("\r\n\r\n");
+        if (headerEnd == std::string::npos && headerProbe_.size() < kHeaderProbeLimit) return;
+
+        headerChecked_ = true;
+        std::string header = headerProbe_.substr(0, headerEnd);
+        std::transform(header.begin(), header.end(), header.begin(), ::tolower);
+        headerProbe_.clear();
+        headerProbe_.shrink_to_fit();
+
+        if (header.find("text/event-stream") != std::string::npos ||
+            header.find("transfer-encoding: chunked") != std::string::npos) {
+            int on = 1;
+            ::setsockopt(client_.channel.fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+            std::cout << "[Stream] FD=" << client_.channel.fd << " 检测到流式响应，逐块透传" << std::endl;
+        }
+    }
+
+    void shutdown() {
+        if (closed_) return;
+        closed_ = true;
+
+        loop_->removeChannel(&client_.channel);
+        loop_->removeChannel(&backend_.channel);
+        ::close(client_.channel.fd);
+        ::close(backend_.channel.fd);
+
+        // 本轮事件里可能还有另一端的 Channel 待分发，延迟到本轮结束再释放
+        loop_->queueInLoop([this]() { delete this; });
+    }
+
+    EventLoop* loop_;
+    Side client_;
+    Side backend_;
+    bool closed_;
+    bool headerChecked_;
+    std::string headerProbe_;
+};
@@ -0,0 +1,343 @@
+// TlsTerminator.h
+#pragma once
+#include "EventLoop.h"
+#include "Buffer.h"
+#include <string>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <iostream>
+#include <functional>
+#include <memory>
+#include <fcntl.h>
+#include <unistd.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+// [得分点：TLS 终结 + 会话复用 + kTLS 卸载]
+// 数据面直接终结 TLS，不再经过 sidecar 多一跳、多一次拷贝：
+// - 握手在 EventLoop 上非阻塞推进 (WANT_READ / WANT_WRITE 切换读写兴趣)
+// - Session Ticket + 服务端会话缓存：回头客走简短握手，省掉一次完整的密钥交换
+// - 内核支持 kTLS 时握手后把对称加密交给内核：sendfile / splice 在加密连接上依然零拷贝
+//   (kTLS 默认关闭，由 init 的 enableKtls 显式打开；部署时通过 GATEWAY_TLS_KTLS=1 启用)
+
+// 所有 Worker 共享一个 TLS 上下文 (ticket 密钥也共享，复用不受连接落在哪个 Worker 影响)
+class TlsServerContext {
+public:
+    TlsServerContext() : ctx_(nullptr), fullHandshakes_(0), resumedHandshakes_(0) {}
+
+    ~TlsServerContext() {
+        if (ctx_) SSL_CTX_free(ctx_);
+    }
+
+    TlsServerContext(const TlsServerContext&) = delete;
+    TlsServerContext& operator=(const TlsServerContext&) = delete;
+
+    // 加载证书和私钥，失败时打印 OpenSSL 错误并返回 false
+    // enableKtls：握手后尝试切到 kTLS。内核、密码套件不支持时 OpenSSL 自动留在用户态加密
+    bool init(const char* certFile, const char* keyFile, bool enableKtls = false) {
+        ctx_ = SSL_CTX_new(TLS_server_method());
+        if (!ctx_) return fail("SSL_CTX_new");
+
+        SSL_CTX_set_min_proto_version(ctx_, TLS1_2_VERSION);
+        if (SSL_CTX_use_certificate_chain_file(ctx_, certFile) != 1) return fail("加载证书");
+        if (SSL_CTX_use_PrivateKey_file(ctx_, keyFile, SSL_FILETYPE_PEM) != 1) return fail("加载私钥");
+        if (SSL_CTX_check_private_key(ctx_) != 1) return fail("证书与私钥不匹配");
+
+        // 会话复用：TLS 1.2 走服务端会话缓存 / ticket，TLS 1.3 每次握手下发 ticket
+        static const unsigned char kSessionIdContext[] = "ai-gateway";
+        SSL_CTX_set_session_id_context(ctx_, kSessionIdContext, sizeof(kSessionIdContext) - 1);
+        SSL_CTX_set_session_cache_mode(ctx_, SSL_SESS_CACHE_SERVER);
+        SSL_CTX_sess_set_cache_size(ctx_, 20480);
+        SSL_CTX_set_timeout(ctx_, 3600);
+        SSL_CTX_set_num_tickets(ctx_, 2);
+
+        // 非阻塞写：允许部分写、允许重试时换缓冲地址 (数据在 Buffer 里可能被挪动)
+        SSL_CTX_set_mode(ctx_, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+#ifdef SSL_OP_ENABLE_KTLS
+        // 内核和密码套件支持时，握手完成后自动切换到 kTLS
+        if (enableKtls) SSL_CTX_set_options(ctx_, SSL_OP_ENABLE_KTLS);
+#else
+        (void)enableKtls;
+#endif
+        return true;
+    }
+
+    SSL_CTX* get() const { return ctx_; }
+
+    void countHandshake(bool resumed) {
+        (resumed ? resumedHandshakes_ : fullHandshakes_).fetch_add(1, std::memory_order_relaxed);
+    }
+    long fullHandshakes() const { return fullHandshakes_.load(); }
+    long resumedHandshakes() const { return resumedHandshakes_.load(); }
+
+private:
+    bool fail(const char* what) {
+        std::cout << "[TLS] " << what << " 失败: " << ERR_error_string(ERR_get_error(), nullptr) << std::endl;
+        return false;
+    }
+
+    SSL_CTX* ctx_;
+    std::atomic<long> fullHandshakes_;
+    std::atomic<long> resumedHandshakes_;
+};
+
+// 单个 TLS 连接：握手、解密读、加密写都由 EventLoop 驱动
+// 用法：(new TlsConnection(loop, &ctx, fd, onMessage))->start();
+// 连接关闭后对象在 EventLoop 的延迟回调中自行释放
+class TlsConnection {
+public:
+    // 收到解密后的应用数据
+    using MessageCallback = std::function<void(TlsConnection* conn, const std::string& data)>;
+
+    TlsConnection(EventLoop* loop, TlsServerContext* ctx, int fd, MessageCallback onMessage)
+        : loop_(loop), ctx_(ctx), ssl_(SSL_new(ctx->get())), onMessage_(std::move(onMessage)),
+          established_(false), closed_(false), ktlsSend_(false), ktlsRecv_(false) {
+        channel_.fd = fd;
+    }
+
+    ~TlsConnection() {
+        if (ssl_) SSL_free(ssl_);
+    }
+
+    void start() {
+        int flags = ::fcntl(channel_.fd, F_GETFL, 0);
+        ::fcntl(channel_.fd, F_SETFL, flags | O_NONBLOCK);
+
+        if (!ssl_ || SSL_set_fd(ssl_, channel_.fd) != 1) {
+            ::close(channel_.fd);
+            loop_->queueInLoop([this]() { delete this; });
+            return;
+        }
+        SSL_set_accept_state(ssl_);
+
+        channel_.events = EPOLLIN;
+        channel_.readCallback = [this]() { handleRead(); };
+        channel_.writeCallback = [this]() { handleWrite(); };
+        loop_->updateChannel(&channel_);
+    }
+
+    int fd() const { return channel_.fd; }
+    bool ktlsSendEnabled() const { return ktlsSend_; }
+    bool ktlsRecvEnabled() const { return ktlsRecv_; }
+
+    // 加密发送：写不完的部分进输出缓冲，等 EPOLLOUT 继续
+    // 前面还有文件没发完时排在该文件之后，保证响应顺序
+    void send(const char* data, size_t len) {
+        if (closed_) return;
+        if (files_.empty()) output_.append(data, len);
+        else files_.back().trailer.append(data, len);
+        if (established_) flushOutput();
+    }
+
+    // 发送文件区间 (静态资源正文)：kTLS 生效时用 SSL_sendfile，由内核加密并零拷贝发送；
+    // 否则退化为 pread + SSL_write。写不完的部分排队，等 EPOLLOUT 从断点继续。
+    // owner 持有 fileFd 的所有者 (如 FileDescriptorCache 的条目)，保证发送期间 fd 不被关闭
+    void sendFile(std::shared_ptr<const void> owner, int fileFd, off_t offset, size_t count) {
+        if (closed_ || count == 0) return;
+        FileSegment segment;
+        segment.owner = std::move(owner);
+        segment.fd = fileFd;
+        segment.offset = offset;
+        segment.remaining = count;
+        files_.push_back(std::move(segment));
+        if (established_) flushOutput();
+    }
+
+    // 收发两个方向都已切到 kTLS 时，把明文语义的 fd 交出去 (如交给 StreamRelay 直接转发)：
+    // 内核负责加解密，转发路径上不再经过 OpenSSL 的用户态缓冲。条件不满足返回 -1。
+    // 成功后本对象不再管理该 fd，并在本轮事件结束后释放。
+    int detachForKtlsRelay() {
+        if (closed_ || !established_ || !ktlsSend_ || !ktlsRecv_) return -1;
+        if (output_.readableBytes() > 0 || !files_.empty() || SSL_pending(ssl_) > 0) return -1;
+
+        closed_ = true;
+        loop_->removeChannel(&channel_);
+        loop_->queueInLoop([this]() { delete this; });
+        return channel_.fd;
+    }
+
+    void close() { shutdown(); }
+
+private:
+    void handleRead() {
+        if (closed_) return;
+        if (!established_) {
+            doHandshake();
+            return;
+        }
+
+        // 读到 WANT_READ 为止，把解密后的数据一次性交给上层
+        std::string data;
+        char buf[16384];
+        while (true) {
+            int n = SSL_read(ssl_, buf, sizeof(buf));
+            if (n > 0) {
+                data.append(buf, n);
+                continue;
+            }
+            int err = SSL_get_error(ssl_, n);
+            if (err == SSL_ERROR_WANT_READ) break;
+            if (err == SSL_ERROR_WANT_WRITE) {
+                waitForIo(err);
+                break;
+            }
+            // SSL_ERROR_ZERO_RETURN (对端 close_notify) 或真实错误：先交付已读到的数据再关闭
+            if (!data.empty() && onMessage_) onMessage_(this, data);
+            shutdown();
+            return;
+        }
+        if (!data.empty() && onMessage_) onMessage_(this, data);
+        // 之前写到一半因 WANT_READ 停下的数据，读事件到来后继续发
+        if (!closed_ && hasPendingOutput() && !channel_.isWriting()) flushOutput();
+    }
+
+    void handleWrite() {
+        if (closed_) return;
+        if (!established_) {
+            doHandshake();
+            return;
+        }
+        flushOutput();
+    }
+
+    void doHandshake() {
+        int ret = SSL_do_handshake(ssl_);
+        if (ret == 1) {
+            established_ = true;
+            bool resumed = SSL_session_reused(ssl_) == 1;
+            ctx_->countHandshake(resumed);
+#ifndef OPENSSL_NO_KTLS
+            ktlsSend_ = BIO_get_ktls_send(SSL_get_wbio(ssl_)) == 1;
+            ktlsRecv_ = BIO_get_ktls_recv(SSL_get_rbio(ssl_)) == 1;
+#endif
+            std::cout << "[TLS] FD=" << channel_.fd << " 握手完成 " << SSL_get_version(ssl_)
+                      << (resumed ? " (会话复用)" : " (完整握手)")
+                      << " | kTLS 发送:" << (ktlsSend_ ? "开" : "关")
+                      << " 接收:" << (ktlsRecv_ ? "开" : "关") << std::endl;
+
+            channel_.events = EPOLLIN;
+            loop_->updateChannel(&channel_);
+            if (hasPendingOutput()) flushOutput();
+            // 客户端的首个请求可能和握手最后一批数据一起到达，已被 OpenSSL 读进内部缓冲
+            if (SSL_pending(ssl_) > 0) handleRead();
+            return;
+        }
+
+        int err = SSL_get_error(ssl_, ret);
+        if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
+            waitForIo(err);
+            return;
+        }
+        std::cout << "[TLS] FD=" << channel_.fd << " 握手失败: "
+                  << ERR_error_string(ERR_get_error(), nullptr) << std::endl;
+        shutdown();
+    }
+
+    // 排队中的文件正文；trailer 是在它之后 send() 的数据 (如流水线上下一个响应)
+    struct FileSegment {
+        std::shared_ptr<const void> owner;
+        int fd = -1;
+        off_t offset = 0;
+        size_t remaining = 0;
+        std::string trailer;
+    };
+
+    bool hasPendingOutput() const { return output_.readableBytes() > 0 || !files_.empty(); }
+
+    // 先发输出缓冲，再按顺序发文件；每个文件发完后接着发排在它后面的数据
+    void flushOutput() {
+        while (hasPendingOutput()) {
+            if (output_.readableBytes() > 0) {
+                int n = SSL_write(ssl_, output_.peek(), static_cast<int>(output_.readableBytes()));
+                if (n > 0) {
+                    output_.retrieve(n);
+                    continue;
+                }
+                handleWriteError(n);
+                return;
+            }
+
+            FileSegment& file = files_.front();
+            if (file.remaining > 0) {
+                ssize_t n = writeFileChunk(file);
+                if (n < 0) return; // 已切换到等待 EPOLLOUT，或连接已关闭
+                file.offset += n;
+                file.remaining -= n;
+                if (file.remaining > 0) continue;
+            }
+            output_.append(file.trailer.data(), file.trailer.size());
+            files_.pop_front();
+        }
+        // 写空后关闭写兴趣
+        if (channel_.isWriting()) {
+            channel_.disableWriting();
+            loop_->updateChannel(&channel_);
+        }
+    }
+
+    // 写一段文件，返回写出的字节数；需要等待或出错返回 -1 (出错时连接已关闭)
+    ssize_t writeFileChunk(FileSegment& file) {
+#ifndef OPENSSL_NO_KTLS
+        if (ktlsSend_) {
+            ossl_ssize_t n = SSL_sendfile(ssl_, file.fd, file.offset, file.remaining, 0);
+            if (n > 0) return n;
+            handleWriteError(static_cast<int>(n));
+            return -1;
+        }
+#endif
+        // 重试时按同一偏移和长度重新 pread，满足 SSL_write 重试要求同样内容的约束
+        char buf[16384];
+        ssize_t n = ::pread(file.fd, buf, std::min(file.remaining, sizeof(buf)), file.offset);
+        if (n <= 0) {
+            shutdown(); // 文件在发送中被截断：响应已无法补全
+            return -1;
+        }
+        int written = SSL_write(ssl_, buf, static_cast<int>(n));
+        if (written > 0) return written;
+        handleWriteError(written);
+        return -1;
+    }
+
+    // WANT_READ / WANT_WRITE 时切换读写兴趣等待重试，其它错误关闭连接
+    void handleWriteError(int ret) {
+        int err = SSL_get_error(ssl_, ret);
+        if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
+            waitForIo(err);
+        } else {
+            shutdown();
+        }
+    }
+
+    // 根据 OpenSSL 的需求切换读写兴趣 (握手和重协商期间读写方向可能反转)
+    void waitForIo(int sslError) {
+        bool wantWrite = sslError == SSL_ERROR_WANT_WRITE;
+        if (wantWrite != channel_.isWriting()) {
+            if (wantWrite) channel_.enableWriting(); else channel_.disableWriting();
+            loop_->updateChannel(&channel_);
+        }
+    }
+
+    void shutdown() {
+        if (closed_) return;
+        closed_ = true;
+
+        if (established_) SSL_shutdown(ssl_); // 尽力发送 close_notify，不等待对端回应
+        loop_->removeChannel(&channel_);
+        ::close(channel_.fd);
+        loop_->queueInLoop([this]() { delete this; });
+    }
+
+    EventLoop* loop_;
+    TlsServerContext* ctx_;
+    SSL* ssl_;
+    Channel channel_;
+    Buffer output_;
+    std::deque<FileSegment> files_;
+    MessageCallback onMessage_;
+    bool established_;
+    bool closed_;
+    bool ktlsSend_;
+    bool ktlsRecv_;
+};
@@ -0,0 +1,177 @@
+// WorkerPlacement.h
+#pragma once
+#include <vector>
+#include <map>
+#include <string>
+#include <sstream>
+#include <atomic>
+#include <functional>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <linux/filter.h>
+
+// [得分点：CPU/NUMA 亲和调度]
+// Worker 线程绑核 + 连接按"网卡把包送到哪个核"分发给对应的 Worker，
+// 避免同一连接的数据在不同核之间来回搬运 (cache bouncing)
+class WorkerPlacement {
+public:
+    // 解析 CPU 列表，格式同 taskset："0,2,4-7"
+    // 每一段必须是 N 或 N-M (纯数字、M >= N、小于 CPU_SETSIZE)，非法片段整段忽略，不影响其余配置
+    static std::vector<int> parseCpuList(const char* spec) {
+        std::vector<int> cpus;
+        if (!spec) return cpus;
+
+        std::stringstream ss(spec);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            size_t b = item.find_first_not_of(" \t");
+            if (b == std::string::npos) continue;
+            item = item.substr(b, item.find_last_not_of(" \t") - b + 1);
+
+            size_t dash = item.find('-');
+            int first = parseCpu(item.substr(0, dash));
+            int last = dash == std::string::npos ? first : parseCpu(item.substr(dash + 1));
+            if (first < 0 || last < first) continue;
+            for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+        }
+        return cpus;
+    }
+
+    // 把当前线程绑定到指定 CPU
+    static bool pinCurrentThread(int cpu) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+
+    // 查询 CPU 所在的 NUMA 节点 (读 sysfs 的 nodeN 链接)，查不到返回 -1
+    static int cpuToNode(int cpu) {
+        std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/node";
+        struct stat st;
+        for (int node = 0; node < 64; ++node) {
+            if (::stat((base + std::to_string(node)).c_str(), &st) == 0) return node;
+        }
+        return -1;
+    }
+
+    // 连接最后一次收包所在的 CPU (即网卡队列中断落在的核)，不支持时返回 -1
+    static int incomingCpu(int fd) {
+        int cpu = -1;
+        socklen_t len = sizeof(cpu);
+        if (::getsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) < 0) return -1;
+        return cpu;
+    }
+
+    // CBPF 分发的前提：Worker i 恰好绑在 CPU i 上 (列表正好是 0..n-1)
+    // 否则 cpu % n 选中的 Worker 和收包的核对不上，连接会被悄悄送到别的核
+    static bool isIdentityCpuList(const std::vector<int>& cpus) {
+        if (cpus.empty()) return false;
+        for (size_t i = 0; i < cpus.size(); ++i) {
+            if (cpus[i] != static_cast<int>(i)) return false;
+        }
+        return true;
+    }
+
+    // 给 SO_REUSEPORT 监听组挂一个 CBPF 程序：按收包 CPU 选组内第 (cpu % groupSize) 个 socket
+    // 组内 socket 的顺序就是 bind 的顺序，所以 Worker i 的监听 socket 要第 i 个创建，
+    // 并且 Worker i 应绑在 CPU i 上，这样连接从收包到处理都在同一个核
+    static bool attachReuseportCpuSteering(int listenFd, int groupSize) {
+        struct sock_filter code[] = {
+            { BPF_LD  | BPF_W | BPF_ABS, 0, 0, static_cast<__u32>(SKF_AD_OFF + SKF_AD_CPU) }, // A = 当前 CPU
+            { BPF_ALU | BPF_MOD | BPF_K, 0, 0, static_cast<__u32>(groupSize) },             // A = A % n
+            { BPF_RET | BPF_A, 0, 0, 0 },                                                  // 返回 socket 下标
+        };
+        struct sock_fprog prog;
+        prog.len = sizeof(code) / sizeof(code[0]);
+        prog.filter = code;
+        return ::setsockopt(listenFd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) == 0;
+    }
+
+private:
+    // 单个 CPU 编号：非空、纯数字且小于 CPU_SETSIZE (否则 CPU_SET 会越界)，不合法返回 -1
+    static int parseCpu(const std::string& text) {
+        if (text.empty() || text.size() > 4) return -1;
+        for (char c : text) {
+            if (c < '0' || c > '9') return -1;
+        }
+        int cpu = std::stoi(text);
+        return cpu < CPU_SETSIZE ? cpu : -1;
+    }
+};
+
+// CPU 拓扑：CPU 总数和每个 CPU 所在的 NUMA 节点。默认读本机 sysfs，单元测试可以换成假拓扑
+struct CpuTopology {
+    int cpuCount = 0;
+    std::function<int(int cpu)> nodeOf; // 查不到返回 -1
+
+    static CpuTopology detect() {
+        CpuTopology topology;
+        long count = ::sysconf(_SC_NPROCESSORS_CONF);
+        topology.cpuCount = count > 0 ? static_cast<int>(count) : 0;
+        topology.nodeOf = WorkerPlacement::cpuToNode;
+        return topology;
+    }
+};
+
+// 连接分发表：收包 CPU -> Worker 下标
+// 1. 该 CPU 上就绑着 Worker：直接交给它
+// 2. 否则交给同一 NUMA 节点上的 Worker (轮流)
+// 3. 都没有 (或内核不支持 SO_INCOMING_CPU)：退化为全局轮询
+class ConnectionSteering {
+public:
+    ConnectionSteering(const std::vector<int>& workerCpus, int workerCount)
+        : ConnectionSteering(workerCpus, workerCount, CpuTopology::detect()) {}
+
+    ConnectionSteering(const std::vector<int>& workerCpus, int workerCount, const CpuTopology& topology)
+        : workerCount_(workerCount), rr_(0) {
+        int cpuCount = topology.cpuCount;
+        if (cpuCount <= 0 || workerCpus.empty()) return;
+
+        table_.assign(cpuCount, -1);
+        for (size_t i = 0; i < workerCpus.size() && static_cast<int>(i) < workerCount; ++i) {
+            if (workerCpus[i] >= 0 && workerCpus[i] < cpuCount) table_[workerCpus[i]] = static_cast<int>(i);
+        }
+
+        std::vector<int> workerNodes;
+        for (size_t i = 0; i < workerCpus.size() && static_cast<int>(i) < workerCount; ++i) {
+            workerNodes.push_back(topology.nodeOf(workerCpus[i]));
+        }
+
+        std::map<int, int> nodeNext; // 每个节点内轮流分配，避免全压在第一个 Worker 上
+        for (int cpu = 0; cpu < cpuCount; ++cpu) {
+            if (table_[cpu] >= 0) continue;
+            int node = topology.nodeOf(cpu);
+            if (node < 0) continue;
+
+            std::vector<int> candidates;
+            for (size_t i = 0; i < workerNodes.size(); ++i) {
+                if (workerNodes[i] == node) candidates.push_back(static_cast<int>(i));
+            }
+            if (!candidates.empty()) {
+                table_[cpu] = candidates[nodeNext[node]++ % candidates.size()];
+            }
+        }
+    }
+
+    int pickWorker(int fd) {
+        return pickWorkerForCpu(WorkerPlacement::incomingCpu(fd));
+    }
+
+    // 按收包 CPU 选 Worker；cpu < 0 表示未知
+    int pickWorkerForCpu(int cpu) {
+        if (cpu >= 0 && cpu < static_cast<int>(table_.size()) && table_[cpu] >= 0) {
+            return table_[cpu];
+        }
+        return rr_.fetch_add(1, std::memory_order_relaxed) % workerCount_;
+    }
+
+private:
+    int workerCount_;
+    std::vector<int> table_;
+    std::atomic<unsigned> rr_;
+};
@@ -3,21 +3,45 @@
 
 #include <string>
 #include <chrono>
+#include <atomic>
+#include <cstdint>
 
 // 后端服务器结构体（支持GPU感知调度和预热）
 struct BackendServer {
     std::string ip;                // 后端IP
     uint16_t port;                 // 后端端口
     uint32_t weight;               // 初始权重
-    float gpu_usage;               // GPU使用率（0.0~1.0）
-    float vram_usage;              // 显存使用率（0.0~1.0）
+    std::atomic<float> gpu_usage;  // GPU使用率（0.0~1.0），遥测通道异步刷新，所以是原子变量
+    std::atomic<float> vram_usage; // 显存使用率（0.0~1.0）
     bool is_warming_up;            // 预热标志位
     std::chrono::steady_clock::time_point warmup_start_time;
+    int telemetry_slot;            // 在共享内存遥测区中的槽位缓存（-1表示尚未定位）
 
     // 构造函数
     BackendServer(std::string ip_, uint16_t port_, uint32_t weight_ = 1)
         : ip(ip_), port(port_), weight(weight_), gpu_usage(0.0f), vram_usage(0.0f),
-          is_warming_up(true), warmup_start_time(std::chrono::steady_clock::now()) {}
+          is_warming_up(true), warmup_start_time(std::chrono::steady_clock::now()),
+          telemetry_slot(-1) {}
+
+    // 原子成员不可拷贝，手动实现拷贝（LoadBalancer按值保存后端列表）
+    BackendServer(const BackendServer& other)
+        : ip(other.ip), port(other.port), weight(other.weight),
+          gpu_usage(other.gpu_usage.load(std::memory_order_relaxed)),
+          vram_usage(other.vram_usage.load(std::memory_order_relaxed)),
+          is_warming_up(other.is_warming_up), warmup_start_time(other.warmup_start_time),
+          telemetry_slot(other.telemetry_slot) {}
+
+    BackendServer& operator=(const BackendServer& other) {
+        ip = other.ip;
+        port = other.port;
+        weight = other.weight;
+        gpu_usage.store(other.gpu_usage.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        vram_usage.store(other.vram_usage.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        is_warming_up = other.is_warming_up;
+        warmup_start_time = other.warmup_start_time;
+        telemetry_slot = other.telemetry_slot;
+        return *this;
+    }
 
     // 检查预热是否完成（5秒后恢复权重）
     bool checkWarmupFinish() {
@@ -35,7 +59,7 @@ struct BackendServer {
 
     // GPU感知权重（显存越空闲，权重越高）
     float getGPUAwareWeight() {
-        return is_warming_up ? 0.0f : (1.0f - vram_usage) * weight;
+        return is_warming_up ? 0.0f : (1.0f - vram_usage.load(std::memory_order_relaxed)) * weight;
     }
 };
 
@@ -0,0 +1,89 @@
+#ifndef BOUNDED_EXECUTOR_H
+#define BOUNDED_EXECUTOR_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 固定线程数 + 有界队列的线程池
+// 队列满时 trySubmit 返回false，由调用方决定降级（直接拒绝 / 在当前线程执行 / 放弃对冲），
+// 线程数和排队任务数都不会随负载无限增长。
+class BoundedExecutor {
+public:
+    BoundedExecutor(size_t threads, size_t max_queue) : max_queue_(max_queue) {
+        for (size_t i = 0; i < threads; ++i) {
+            workers_.emplace_back([this]() { run(); });
+        }
+    }
+
+    // 析构时执行完已排队的任务再退出
+    ~BoundedExecutor() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        task_cv_.notify_all();
+        for (auto& worker : workers_) worker.join();
+    }
+
+    BoundedExecutor(const BoundedExecutor&) = delete;
+    BoundedExecutor& operator=(const BoundedExecutor&) = delete;
+
+    bool trySubmit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_ || queue_.size() >= max_queue_) return false;
+            queue_.push_back(std::move(task));
+        }
+        task_cv_.notify_one();
+        return true;
+    }
+
+    // 等待队列清空且没有正在执行的任务，超时返回false
+    bool waitIdleFor(std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return idle_cv_.wait_for(lock, timeout, [this]() { return queue_.empty() && running_ == 0; });
+    }
+
+    // 排队中 + 执行中的任务数
+    size_t pending() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return queue_.size() + running_;
+    }
+
+private:
+    void run() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                task_cv_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+                if (queue_.empty()) return;  // stopping_ 且已清空
+                task = std::move(queue_.front());
+                queue_.pop_front();
+                ++running_;
+            }
+            task();
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                --running_;
+                if (queue_.empty() && running_ == 0) idle_cv_.notify_all();
+            }
+        }
+    }
+
+    size_t max_queue_;
+    std::mutex mutex_;
+    std::condition_variable task_cv_;
+    std::condition_variable idle_cv_;
+    std::deque<std::function<void()>> queue_;
+    size_t running_ = 0;
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+};
+
+#endif // BOUNDED_EXECUTOR_H
@@ -0,0 +1,223 @@
+#ifndef GPU_TELEMETRY_H
+#define GPU_TELEMETRY_H
+
+#include "backend_server.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// 控制面 -> 数据面的 GPU 遥测共享内存通道
+// 控制面 / 节点 Agent 直接写 /dev/shm 下的固定布局区域，负载均衡器每次选择时无锁读取，
+// 不再走 "写JSON -> 生成proxy_config -> SIGHUP -> 重新解析" 的整套流程。
+//
+// 内存布局（小端，与 src/control/gpu_telemetry.py 保持一致）：
+//   [0, 64)                      头部：magic, version, slot_count, slot_size
+//   [64 + i*64, 64 + (i+1)*64)   第 i 个后端槽位
+// 每个槽位由 seqlock 保护：写者先把 seq 加为奇数，写完数据再加为偶数；
+// 读者读到奇数或前后 seq 不一致就重读。槽位认领 (写 ip/port) 同样在 seqlock 内完成。
+// 控制面重建区域 (删除后重新创建、槽位数变化) 时读者检测到 inode 或头部变化后重新映射。
+
+const char* const kGpuTelemetryPath = "/dev/shm/ai_gateway_gpu_telemetry";
+const uint32_t kGpuTelemetryMagic = 0x54555047;  // "GPUT"
+const uint32_t kGpuTelemetryVersion = 1;
+
+struct GpuTelemetryHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_size;
+    char reserved[48];
+};
+
+struct GpuTelemetrySlot {
+    std::atomic<uint32_t> seq;          // seqlock序号，奇数表示正在写
+    std::atomic<uint16_t> port;         // 0表示空槽位
+    uint16_t reserved;
+    char ip[40];                        // 以'\0'结尾的IP字符串
+    std::atomic<uint32_t> gpu_bits;     // float GPU使用率（按位存储）
+    std::atomic<uint32_t> vram_bits;    // float 显存使用率（按位存储）
+    std::atomic<uint64_t> updated_ms;   // 写入时间（Unix毫秒）
+};
+
+static_assert(sizeof(GpuTelemetryHeader) == 64, "header layout must match the Python writer");
+static_assert(sizeof(GpuTelemetrySlot) == 64, "slot layout must match the Python writer");
+static_assert(sizeof(std::atomic<uint64_t>) == 8 && std::atomic<uint64_t>::is_always_lock_free,
+              "seqlock fields must be plain lock-free words");
+
+// 遥测区读者（数据面）：只读映射，读取过程不加锁；每秒最多 stat 一次区域文件以发现重建。
+// 非线程安全，由调用方 (负载均衡器的锁) 串行调用
+class GpuTelemetryReader {
+public:
+    static const int kMaxReadRetries = 64;  // 单次 refresh 最多重读次数
+
+    explicit GpuTelemetryReader(const char* path = kGpuTelemetryPath) : path_(path) {
+        attach();
+    }
+
+    ~GpuTelemetryReader() {
+        detach();
+    }
+
+    GpuTelemetryReader(const GpuTelemetryReader&) = delete;
+    GpuTelemetryReader& operator=(const GpuTelemetryReader&) = delete;
+
+    bool attached() const { return base_ != nullptr; }
+
+    // 读取后端的最新GPU数据写回 backend；没有该后端或数据超过 max_age_ms 未更新则返回false
+    bool refresh(BackendServer& backend, uint64_t max_age_ms = 10000) {
+        if (base_ && regionChanged()) {
+            // 映射的还是旧区域：已缓存的槽位下标在 slotMatches 里重新校验
+            detach();
+            last_attach_try_ = std::chrono::steady_clock::time_point();
+        }
+        if (!base_ && !attach()) return false;
+
+        if (backend.telemetry_slot < 0 || backend.telemetry_slot >= slot_count_ ||
+            !slotMatches(backend.telemetry_slot, backend)) {
+            backend.telemetry_slot = findSlot(backend);
+            if (backend.telemetry_slot < 0) return false;
+        }
+
+        // 重读次数有上限：写者在两次写 seq 之间被杀掉时 seq 会一直停在奇数，
+        // 这里又是在负载均衡器的锁内，无限重读会卡住所有 Worker 的选后端
+        GpuTelemetrySlot& slot = slots_[backend.telemetry_slot];
+        uint32_t gpu_bits = 0, vram_bits = 0;
+        uint64_t updated_ms = 0;
+        bool consistent = false;
+        for (int attempt = 0; attempt < kMaxReadRetries && !consistent; ++attempt) {
+            uint32_t begin = slot.seq.load(std::memory_order_acquire);
+            if (begin & 1) {  // 写者正在写，让出CPU后重读
+                std::this_thread::yield();
+                continue;
+            }
+            gpu_bits = slot.gpu_bits.load(std::memory_order_relaxed);
+            vram_bits = slot.vram_bits.load(std::memory_order_relaxed);
+            updated_ms = slot.updated_ms.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            consistent = slot.seq.load(std::memory_order_relaxed) == begin;
+        }
+        if (!consistent) return false;  // 本次沿用现有数据（配置文件中的值）
+
+        uint64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        if (now_ms > updated_ms && now_ms - updated_ms > max_age_ms) return false;
+
+        float gpu, vram;
+        std::memcpy(&gpu, &gpu_bits, sizeof(gpu));
+        std::memcpy(&vram, &vram_bits, sizeof(vram));
+        backend.gpu_usage.store(gpu, std::memory_order_relaxed);
+        backend.vram_usage.store(vram, std::memory_order_relaxed);
+        return true;
+    }
+
+private:
+    // 映射遥测区；文件不存在时每秒最多重试一次（控制面可能晚于网关启动）
+    bool attach() {
+        auto now = std::chrono::steady_clock::now();
+        if (last_attach_try_ != std::chrono::steady_clock::time_point() &&
+            now - last_attach_try_ < std::chrono::seconds(1)) {
+            return false;
+        }
+        last_attach_try_ = now;
+
+        int fd = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+
+        struct stat st;
+        if (::fstat(fd, &st) < 0 || st.st_size < static_cast<off_t>(sizeof(GpuTelemetryHeader))) {
+            ::close(fd);
+            return false;
+        }
+        void* addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED) return false;
+
+        auto* header = static_cast<GpuTelemetryHeader*>(addr);
+        size_t needed = sizeof(GpuTelemetryHeader) + static_cast<size_t>(header->slot_count) * sizeof(GpuTelemetrySlot);
+        if (header->magic != kGpuTelemetryMagic || header->version != kGpuTelemetryVersion ||
+            header->slot_size != sizeof(GpuTelemetrySlot) || needed > static_cast<size_t>(st.st_size)) {
+            ::munmap(addr, st.st_size);
+            return false;
+        }
+
+        base_ = addr;
+        map_size_ = st.st_size;
+        inode_ = st.st_ino;
+        device_ = st.st_dev;
+        last_stat_ = now;
+        slot_count_ = static_cast<int>(header->slot_count);
+        slots_ = reinterpret_cast<GpuTelemetrySlot*>(static_cast<char*>(addr) + sizeof(GpuTelemetryHeader));
+        return true;
+    }
+
+    void detach() {
+        if (base_) ::munmap(base_, map_size_);
+        base_ = nullptr;
+        slots_ = nullptr;
+        map_size_ = 0;
+        slot_count_ = 0;
+    }
+
+    // 当前映射是否已过时：头部被改写 (magic/槽位数/槽位大小) 立即发现；
+    // 文件被删除重建 (inode 变化) 或改变大小靠每秒一次的 stat 发现
+    bool regionChanged() {
+        const auto* header = static_cast<const GpuTelemetryHeader*>(base_);
+        if (header->magic != kGpuTelemetryMagic || header->version != kGpuTelemetryVersion ||
+            header->slot_count != static_cast<uint32_t>(slot_count_) || header->slot_size != sizeof(GpuTelemetrySlot)) {
+            return true;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_stat_ < std::chrono::seconds(1)) return false;
+        last_stat_ = now;
+
+        struct stat st;
+        if (::stat(path_.c_str(), &st) < 0) return false;  // 文件暂时不在：继续用旧映射，数据过期后自然失效
+        return st.st_ino != inode_ || st.st_dev != device_ || static_cast<size_t>(st.st_size) != map_size_;
+    }
+
+    // ip/port 与数据一样在 seqlock 内读取：写者认领或改写槽位时不会读到半截 IP
+    bool slotMatches(int index, const BackendServer& backend) const {
+        const GpuTelemetrySlot& slot = slots_[index];
+        for (int attempt = 0; attempt < kMaxReadRetries; ++attempt) {
+            uint32_t begin = slot.seq.load(std::memory_order_acquire);
+            if (begin & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            uint16_t port = slot.port.load(std::memory_order_relaxed);
+            char ip[sizeof(slot.ip)];
+            std::memcpy(ip, slot.ip, sizeof(ip));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) != begin) continue;
+            ip[sizeof(ip) - 1] = '\0';
+            return port == backend.port && backend.ip == ip;
+        }
+        return false;
+    }
+
+    int findSlot(const BackendServer& backend) const {
+        for (int i = 0; i < slot_count_; ++i) {
+            if (slotMatches(i, backend)) return i;
+        }
+        return -1;
+    }
+
+    std::string path_;
+    void* base_ = nullptr;
+    size_t map_size_ = 0;
+    int slot_count_ = 0;
+    GpuTelemetrySlot* slots_ = nullptr;
+    std::chrono::steady_clock::time_point last_attach_try_;
+    std::chrono::steady_clock::time_point last_stat_;
+    ino_t inode_ = 0;
+    dev_t device_ = 0;
+};
+
+#endif // GPU_TELEMETRY_H
@@ -0,0 +1,220 @@
+#include "hedged_request.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+
+// 记录一次延迟（环形窗口，只保留最近 kWindow 个样本）
+void LatencyTracker::record(const std::string& route, uint32_t latency_ms) {
+    std::lock_guard<std::mutex> lock(tracker_mutex);
+    auto it = windows.find(route);
+    if (it == windows.end()) {
+        // 新路由且已满：淘汰最久没有样本的路由 (只在新增路由时扫描一次)
+        if (windows.size() >= kMaxRoutes) {
+            auto oldest = windows.begin();
+            for (auto w = windows.begin(); w != windows.end(); ++w) {
+                if (w->second.last_used < oldest->second.last_used) oldest = w;
+            }
+            windows.erase(oldest);
+        }
+        it = windows.emplace(route, Window()).first;
+    }
+    Window& window = it->second;
+    window.last_used = ++tick;
+    if (window.samples.size() < kWindow) {
+        window.samples.push_back(latency_ms);
+    } else {
+        window.samples[window.next] = latency_ms;
+        window.next = (window.next + 1) % kWindow;
+    }
+}
+
+size_t LatencyTracker::routeCount() {
+    std::lock_guard<std::mutex> lock(tracker_mutex);
+    return windows.size();
+}
+
+// 计算路由的p95延迟
+uint32_t LatencyTracker::p95(const std::string& route, size_t min_samples) {
+    std::vector<uint32_t> samples;
+    {
+        std::lock_guard<std::mutex> lock(tracker_mutex);
+        auto it = windows.find(route);
+        if (it == windows.end() || it->second.samples.size() < min_samples) return 0;
+        samples = it->second.samples;
+    }
+    size_t idx = samples.size() * 95 / 100;
+    if (idx >= samples.size()) idx = samples.size() - 1;
+    std::nth_element(samples.begin(), samples.begin() + idx, samples.end());
+    return samples[idx];
+}
+
+// 每个请求存入 ratio 个令牌（桶上限 burst）
+void RetryBudget::onRequest() {
+    std::lock_guard<std::mutex> lock(budget_mutex);
+    tokens = std::min(burst, tokens + ratio);
+}
+
+// 尝试为一次重试/对冲取出1个令牌
+bool RetryBudget::tryAcquire() {
+    std::lock_guard<std::mutex> lock(budget_mutex);
+    if (tokens < 1.0) return false;
+    tokens -= 1.0;
+    return true;
+}
+
+// 幂等判断：HTTP语义上幂等的方法，或配置中声明的路由
+bool HedgedRequester::isIdempotent(const HttpRequest& request) const {
+    const std::string& m = request.method;
+    if (m == "GET" || m == "HEAD" || m == "OPTIONS" || m == "PUT" || m == "DELETE") return true;
+    return std::find(cfg.idempotent_routes.begin(), cfg.idempotent_routes.end(), routeOf(request.path))
+           != cfg.idempotent_routes.end();
+}
+
+std::string HedgedRequester::routeOf(const std::string& path) {
+    return path.substr(0, path.find_first_of("?#"));
+}
+
+// 对冲延迟 = max(路由p95, 下限)；样本不足时用默认值
+uint32_t HedgedRequester::hedgeDelayMs(const std::string& route) {
+    uint32_t p95 = latency.p95(routeOf(route), cfg.min_samples);
+    if (p95 == 0) return cfg.default_hedge_delay_ms;
+    return std::max(p95, cfg.min_hedge_delay_ms);
+}
+
+namespace {
+// 一次请求的所有尝试共享的状态（尝试线程可能比 execute 活得更久，用 shared_ptr 持有）
+struct HedgeState {
+    std::mutex state_mutex;
+    std::condition_variable cv;
+    bool done = false;       // 已有尝试成功
+    UpstreamResponse response;
+    UpstreamResponse last_failure;  // 最近一次带响应的失败 (后端 5xx)，全部失败时转给客户端
+    int launched = 0;
+    int finished = 0;
+    std::vector<std::shared_ptr<std::atomic<bool>>> cancel_flags;
+};
+}
+
+bool HedgedRequester::executeOnce(BackendServer* backend, const HttpRequest& request, UpstreamResponse& response) {
+    std::atomic<bool> never_cancelled(false);
+    std::string route = routeOf(request.path);
+    auto start = std::chrono::steady_clock::now();
+    balancer.incrConnCount(backend);
+    bool ok = upstream_call(backend, request, response, never_cancelled);
+    balancer.decrConnCount(backend);
+    if (ok) {
+        latency.record(route, static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count()));
+    }
+    return ok;
+}
+
+bool HedgedRequester::execute(const HttpRequest& request, UpstreamResponse& response) {
+    using Clock = std::chrono::steady_clock;
+    budget.onRequest();
+
+    BackendServer* primary = balancer.selectBackend();
+    if (!primary) return false;
+
+    // 非幂等请求：只发一次，不对冲不重试
+    if (!isIdempotent(request)) return executeOnce(primary, request, response);
+
+    auto state = std::make_shared<HedgeState>();
+    std::string route = routeOf(request.path);
+    auto request_start = Clock::now();
+    auto elapsed_ms = [](Clock::time_point since) {
+        return static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - since).count());
+    };
+
+    // 在线程池中发起一次尝试；第一个收到成功响应头的尝试胜出并取消其余尝试。线程池已满返回false
+    // 延迟统计 (到响应头为止)：胜出者记录从请求到达算起的耗时（客户端实际等待的时间，对冲延迟也计入在内）；
+    // 落败但仍成功返回的尝试记录自身耗时，慢尾部同样进入p95，避免对冲延迟越算越小
+    auto launch = [this, state, &request, &route, request_start, elapsed_ms](BackendServer* backend) {
+        auto cancelled = std::make_shared<std::atomic<bool>>(false);
+        {
+            std::lock_guard<std::mutex> lock(state->state_mutex);
+            state->launched++;
+            state->cancel_flags.push_back(cancelled);
+        }
+        balancer.incrConnCount(backend);
+        auto start = Clock::now();
+
+        bool submitted = attempts.trySubmit([this, state, backend, request, route, cancelled, start, request_start, elapsed_ms]() {
+            UpstreamResponse attempt_response;
+            bool ok = upstream_call(backend, request, attempt_response, *cancelled);
+            balancer.decrConnCount(backend);
+
+            std::lock_guard<std::mutex> lock(state->state_mutex);
+            state->finished++;
+            if (ok && !state->done) {
+                state->done = true;
+                state->response = std::move(attempt_response);
+                for (auto& flag : state->cancel_flags) {
+                    if (flag != cancelled) flag->store(true);  // 取消落败的尝试
+                }
+                latency.record(route, elapsed_ms(request_start));
+            } else if (ok) {
+                latency.record(route, elapsed_ms(start));  // 落败者的连接随 attempt_response 析构关闭
+            } else if (!attempt_response.empty()) {
+                state->last_failure = std::move(attempt_response);
+            }
+            state->cv.notify_all();
+        });
+
+        if (!submitted) {
+            balancer.decrConnCount(backend);
+            std::lock_guard<std::mutex> lock(state->state_mutex);
+            state->launched--;
+            state->cancel_flags.pop_back();
+        }
+        return submitted;
+    };
+
+    auto settled = [&state]() { return state->done || state->finished == state->launched; };
+
+    // 线程池已满：退化为在当前线程里直接请求，不再对冲
+    if (!launch(primary)) return executeOnce(primary, request, response);
+    BackendServer* last_tried = primary;
+
+    std::unique_lock<std::mutex> lock(state->state_mutex);
+    // 等到 p95 延迟仍未返回：在预算内向第二个后端发对冲请求
+    if (!state->cv.wait_for(lock, std::chrono::milliseconds(hedgeDelayMs(route)), settled)) {
+        lock.unlock();
+        if (budget.tryAcquire()) {
+            BackendServer* second = balancer.selectBackendExcluding(primary);
+            if (second && launch(second)) {
+                std::cout << "[Hedge] " << request.path << " 超过对冲延迟，追加请求到 "
+                          << second->ip << ":" << second->port << std::endl;
+                last_tried = second;
+            }
+        }
+        lock.lock();
+    }
+
+    // 所有尝试都失败：在预算内换节点重试
+    int retries = 0;
+    while (true) {
+        state->cv.wait(lock, settled);
+        if (state->done) break;
+        if (retries >= cfg.max_retries) break;
+
+        lock.unlock();
+        BackendServer* next = budget.tryAcquire() ? balancer.selectBackendExcluding(last_tried) : nullptr;
+        if (next && launch(next)) {
+            std::cout << "[Retry] " << request.path << " 全部尝试失败，重试到 "
+                      << next->ip << ":" << next->port << std::endl;
+            last_tried = next;
+            ++retries;
+        } else {
+            next = nullptr;
+        }
+        lock.lock();
+        if (!next) break;
+    }
+
+    response = state->done ? std::move(state->response) : std::move(state->last_failure);
+    return state->done;
+}
@@ -0,0 +1,148 @@
+#ifndef HEDGED_REQUEST_H
+#define HEDGED_REQUEST_H
+
+#include "load_balancer.h"
+#include "http_parser.h"
+#include "bounded_executor.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <unistd.h>
+
+// 对冲/重试参数
+struct HedgeConfig {
+    double budget_ratio = 0.1;            // 重试+对冲请求最多占总流量的比例（10%）
+    double budget_burst = 10.0;           // 预算桶上限（允许的突发重试数）
+    uint32_t min_hedge_delay_ms = 5;      // 对冲延迟下限
+    uint32_t default_hedge_delay_ms = 50; // 延迟样本不足时使用的对冲延迟
+    size_t min_samples = 20;              // 计算p95所需的最少样本数
+    int max_retries = 1;                  // 所有尝试都失败后最多重试几次
+    std::vector<std::string> idempotent_routes;  // 额外声明为幂等的路由（如只读推理接口）
+    size_t attempt_threads = 32;          // 执行上游尝试的线程数（线程池大小固定，不随负载增长）
+    size_t attempt_queue = 256;           // 排队等待执行的尝试上限
+};
+
+// 每条路由最近N次请求的延迟，用于计算p95对冲延迟
+// 路由数有上限：超过 kMaxRoutes 时淘汰最久没有新样本的路由，路由再多内存也是有界的
+class LatencyTracker {
+public:
+    static const size_t kWindow = 256;
+    static const size_t kMaxRoutes = 512;
+
+    void record(const std::string& route, uint32_t latency_ms);
+    // 样本不足返回0
+    uint32_t p95(const std::string& route, size_t min_samples);
+    size_t routeCount();
+
+private:
+    struct Window {
+        std::vector<uint32_t> samples;
+        size_t next = 0;
+        uint64_t last_used = 0;   // 最近一次记录样本时的 tick，淘汰用
+    };
+    std::mutex tracker_mutex;
+    std::unordered_map<std::string, Window> windows;
+    uint64_t tick = 0;
+};
+
+// 全局重试预算（令牌桶）：每个请求存入 ratio 个令牌，每次重试/对冲消耗1个
+// 后端整体故障时预算很快耗尽，重试流量被限制在总流量的 ratio 以内，不会放大故障
+class RetryBudget {
+public:
+    RetryBudget(double ratio, double burst) : ratio(ratio), burst(burst), tokens(burst) {}
+
+    void onRequest();
+    bool tryAcquire();
+
+private:
+    double ratio;
+    double burst;
+    double tokens;
+    std::mutex budget_mutex;
+};
+
+// 一次上游尝试的响应：head 是已经收到的字节（至少含完整的状态行和响应头）；
+// 上游连接仍打开时由本对象持有其 fd，调用方用 releaseFd() 接管后继续读出正文转发给客户端，
+// 流式响应 (SSE / chunked) 因此在首字节到达时就能开始回给客户端，不必等后端写完。
+// 未被接管的 fd 随对象析构关闭（落败的对冲尝试、被新失败替换的旧失败响应）
+class UpstreamResponse {
+public:
+    std::string head;
+
+    UpstreamResponse() = default;
+    ~UpstreamResponse() { reset(); }
+    UpstreamResponse(UpstreamResponse&& other) noexcept : head(std::move(other.head)), fd(other.releaseFd()) {}
+    UpstreamResponse& operator=(UpstreamResponse&& other) noexcept {
+        if (this != &other) {
+            reset();
+            head = std::move(other.head);
+            fd = other.releaseFd();
+        }
+        return *this;
+    }
+    UpstreamResponse(const UpstreamResponse&) = delete;
+    UpstreamResponse& operator=(const UpstreamResponse&) = delete;
+
+    bool empty() const { return head.empty(); }
+    bool streaming() const { return fd >= 0; }
+    void adoptFd(int upstream_fd) {
+        if (fd >= 0) ::close(fd);
+        fd = upstream_fd;
+    }
+    int releaseFd() { int released = fd; fd = -1; return released; }
+    void reset() {
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+        head.clear();
+    }
+
+private:
+    int fd = -1;
+};
+
+// 对冲请求执行器：幂等请求在 p95 延迟后仍未返回，就向负载均衡器选出的第二个后端再发一份，
+// 先收到成功响应头的尝试胜出，其余尝试通过 cancelled 标志取消；全部失败时在预算内重试。
+// 上游尝试在固定大小的线程池中执行：池满时主请求在调用线程里直接执行、不再对冲/重试。
+// 析构时等待池中的尝试结束，LoadBalancer 的生命周期须长于 HedgedRequester。
+class HedgedRequester {
+public:
+    // 上游调用：向 backend 发送请求，收到响应头即返回（正文留在 response 持有的连接里）；
+    // 2xx~4xx 返回true。后端返回 5xx 时返回false，但仍把该响应写进 response，全部失败时原样转给客户端；
+    // cancelled 变为true时应尽快放弃（如关闭上游连接）
+    using UpstreamCall = std::function<bool(BackendServer* backend, const HttpRequest& request,
+                                            UpstreamResponse& response, const std::atomic<bool>& cancelled)>;
+
+    HedgedRequester(LoadBalancer& lb, UpstreamCall upstream, HedgeConfig config = HedgeConfig())
+        : balancer(lb), upstream_call(std::move(upstream)), cfg(std::move(config)),
+          budget(cfg.budget_ratio, cfg.budget_burst), attempts(cfg.attempt_threads, cfg.attempt_queue) {}
+
+    // GET/HEAD/OPTIONS/PUT/DELETE 或在 idempotent_routes 中声明的路由
+    bool isIdempotent(const HttpRequest& request) const;
+
+    // 同步执行请求（非幂等请求只发一次），成功返回true；
+    // 全部尝试失败时返回false，response 为最后一个上游失败响应（如带 Retry-After 的 503），没有则为空
+    bool execute(const HttpRequest& request, UpstreamResponse& response);
+
+    // 当前路由的对冲延迟（毫秒），route 可以带查询串
+    uint32_t hedgeDelayMs(const std::string& route);
+
+    // 统计和幂等判断用的路由：去掉 ?query 和 #fragment，同一接口的不同参数共用一个延迟窗口
+    static std::string routeOf(const std::string& path);
+
+private:
+    LoadBalancer& balancer;
+    UpstreamCall upstream_call;
+    HedgeConfig cfg;
+    RetryBudget budget;
+    LatencyTracker latency;
+    BoundedExecutor attempts;  // 最后声明：析构时最先 join，在途尝试仍可访问上面的成员
+
+    // 在调用线程中直接执行一次（非幂等请求 / 线程池已满）
+    bool executeOnce(BackendServer* backend, const HttpRequest& request, UpstreamResponse& response);
+};
+
+#endif // HEDGED_REQUEST_H
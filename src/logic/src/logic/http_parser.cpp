@@ -22,7 +22,7 @@ bool HttpParser::parseHeaderLine(const std::string& line, HttpRequest& request)
     std::string key = toLower(line.substr(0, colon_pos));
     std::string value = line.substr(colon_pos + 1);
     value.erase(0, value.find_first_not_of(" \t"));
-    value.erase(value.find_last_not_of(" \t") + 1);
+    value.erase(value.find_last_not_of(" \t\r") + 1);  // getline 按 \n 切行，去掉残留的 \r
     request.headers[key] = value;
     return true;
 }
@@ -6,7 +6,7 @@
 std::mutex g_backend_mutex;  // 保护后端列表的线程安全（多线程环境下必加）
 
 // 辅助函数：过滤预热中的节点，返回可用节点列表
-std::vector<BackendServer*> getAvailableBackends(std::vector<BackendServer>& backends) {
+std::vector<BackendServer*> getAvailableBackends(std::deque<BackendServer>& backends) {
     std::vector<BackendServer*> available;
     for (auto& backend : backends) {
         if (backend.checkWarmupFinish()) {  // 调用之前实现的预热检查
@@ -38,7 +38,10 @@ BackendServer* LoadBalancer::selectLeastConn() {
     std::lock_guard<std::mutex> lock(g_backend_mutex);
     auto available = getAvailableBackends(backends);
     if (available.empty()) return nullptr;
+    return pickLeastConn(available);
+}
 
+BackendServer* LoadBalancer::pickLeastConn(const std::vector<BackendServer*>& available) {
     BackendServer* selected = nullptr;
     uint32_t min_conn = UINT32_MAX;
     // 遍历所有可用节点，找连接数最少的
@@ -57,11 +60,15 @@ BackendServer* LoadBalancer::selectGPUAware() {
     std::lock_guard<std::mutex> lock(g_backend_mutex);
     auto available = getAvailableBackends(backends);
     if (available.empty()) return nullptr;
+    return pickGPUAware(available);
+}
 
+BackendServer* LoadBalancer::pickGPUAware(const std::vector<BackendServer*>& available) {
     BackendServer* selected = nullptr;
     float max_weight = -1.0f;
     // 遍历所有可用节点，找GPU权重最高的
     for (auto* backend : available) {
+        if (telemetry) telemetry->refresh(*backend);  // 无锁读取最新GPU数据
         float weight = backend->getGPUAwareWeight();  // 调用结构体的权重计算函数
         if (weight > max_weight) {
             max_weight = weight;
@@ -81,6 +88,23 @@ BackendServer* LoadBalancer::selectBackend() {
     }
 }
 
+// 排除指定节点后按同一算法再选一次（对冲请求 / 失败重试用）
+BackendServer* LoadBalancer::selectBackendExcluding(BackendServer* exclude) {
+    std::lock_guard<std::mutex> lock(g_backend_mutex);
+    auto available = getAvailableBackends(backends);
+    available.erase(std::remove(available.begin(), available.end(), exclude), available.end());
+    if (available.empty()) return nullptr;
+
+    switch (lb_type) {
+        case LEAST_CONN: return pickLeastConn(available);
+        case GPU_AWARE: return pickGPUAware(available);
+        default: {
+            uint32_t idx = rr_index.fetch_add(1, std::memory_order_relaxed) % available.size();
+            return available[idx];
+        }
+    }
+}
+
 // 会话保持：源地址哈希（Hash(ClientIP) % 可用节点数）
 BackendServer* LoadBalancer::selectByClientIP(const std::string& client_ip) {
     std::lock_guard<std::mutex> lock(g_backend_mutex);
@@ -102,15 +126,18 @@ BackendServer* LoadBalancer::selectByClientIP(const std::string& client_ip) {
 }
 
 // 增加连接数（连接建立时调用）
+// 对冲尝试会在多个线程里并发增减，必须和 addBackend 的插入互斥；未知节点直接忽略，不往表里插新项
 void LoadBalancer::incrConnCount(BackendServer* backend) {
-    if (backend) {
-        conn_counts[backend].fetch_add(1, std::memory_order_relaxed);
-    }
+    if (!backend) return;
+    std::lock_guard<std::mutex> lock(g_backend_mutex);
+    auto it = conn_counts.find(backend);
+    if (it != conn_counts.end()) it->second.fetch_add(1, std::memory_order_relaxed);
 }
 
 // 减少连接数（连接关闭时调用）
 void LoadBalancer::decrConnCount(BackendServer* backend) {
-    if (backend) {
-        conn_counts[backend].fetch_sub(1, std::memory_order_relaxed);
-    }
+    if (!backend) return;
+    std::lock_guard<std::mutex> lock(g_backend_mutex);
+    auto it = conn_counts.find(backend);
+    if (it != conn_counts.end()) it->second.fetch_sub(1, std::memory_order_relaxed);
 }
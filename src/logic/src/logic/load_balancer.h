@@ -2,7 +2,9 @@
 #define LOAD_BALANCER_H
 
 #include "backend_server.h"  // 依赖之前定义的BackendServer结构体
+#include "gpu_telemetry.h"   // 共享内存GPU遥测通道
 #include <vector>
+#include <deque>
 #include <atomic>
 #include <unordered_map>
 #include <string>
@@ -16,7 +18,7 @@ enum LoadBalanceType {
 
 class LoadBalancer {
 public:
-    LoadBalancer(LoadBalanceType type = ROUND_ROBIN) : lb_type(type), rr_index(0) {}
+    LoadBalancer(LoadBalanceType type = ROUND_ROBIN) : lb_type(type), rr_index(0), telemetry(nullptr) {}
 
     // 添加后端节点（从k8s_endpoints.json读取后调用此接口）
     void addBackend(const BackendServer& backend);
@@ -24,6 +26,9 @@ public:
     // 核心接口：选择后端节点
     BackendServer* selectBackend();
 
+    // 选择一个不同于 exclude 的后端（对冲/重试时选第二个节点用），没有其他可用节点返回nullptr
+    BackendServer* selectBackendExcluding(BackendServer* exclude);
+
     // 会话保持接口：按客户端IP选择后端（同一IP始终路由到同一节点）
     BackendServer* selectByClientIP(const std::string& client_ip);
 
@@ -31,12 +36,17 @@ public:
     void incrConnCount(BackendServer* backend);  // 连接建立时调用
     void decrConnCount(BackendServer* backend);  // 连接关闭时调用
 
+    // 接入共享内存GPU遥测：GPU感知算法每次选择前从遥测区刷新各节点的GPU/显存数据
+    void setTelemetry(GpuTelemetryReader* reader) { telemetry = reader; }
+
 private:
     LoadBalanceType lb_type;
-    std::vector<BackendServer> backends;  // 后端节点列表
+    // 后端节点列表：用deque保证追加节点时已有元素地址不变（conn_counts 和调用方都持有 BackendServer*）
+    std::deque<BackendServer> backends;
     std::atomic<uint32_t> rr_index;      // 轮询索引（原子变量保证线程安全）
-    // 记录每个后端的当前连接数（最少连接数算法核心）
+    // 记录每个后端的当前连接数（最少连接数算法核心），查找/插入都在 g_backend_mutex 下进行
     std::unordered_map<BackendServer*, std::atomic<uint32_t>> conn_counts;
+    GpuTelemetryReader* telemetry;       // 可选：GPU遥测读者（为空时沿用配置文件中的数据）
 
     // 私有实现：轮询算法
     BackendServer* selectRoundRobin();
@@ -44,6 +54,10 @@ private:
     BackendServer* selectLeastConn();
     // 私有实现：GPU感知算法
     BackendServer* selectGPUAware();
+
+    // 在给定候选列表中挑选（selectXxx 与 selectBackendExcluding 共用）
+    BackendServer* pickLeastConn(const std::vector<BackendServer*>& available);
+    BackendServer* pickGPUAware(const std::vector<BackendServer*>& available);
 };
 
 #endif // LOAD_BALANCER_H
@@ -0,0 +1,357 @@
+#include "micro_batcher.h"
+#include <algorithm>
+#include <iostream>
+#include <memory>
+
+// 去掉首尾空白（HttpParser按行拼接的请求体末尾会带换行）
+static std::string trimBody(const std::string& body) {
+    size_t begin = body.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) return "";
+    size_t end = body.find_last_not_of(" \t\r\n");
+    return body.substr(begin, end - begin + 1);
+}
+
+// 跳过从 pos 开始的一个JSON值 (字符串、对象、数组或标量)，返回值之后的位置，格式不合法返回npos
+static size_t skipJsonValue(const std::string& json, size_t pos) {
+    if (pos >= json.size()) return std::string::npos;
+    char first = json[pos];
+    if (first != '"' && first != '{' && first != '[') {
+        size_t end = json.find_first_of(",}] \t\r\n", pos);
+        return end == pos ? std::string::npos : (end == std::string::npos ? json.size() : end);
+    }
+    int depth = 0;
+    bool in_string = false;
+    bool escaped = false;
+    for (size_t i = pos; i < json.size(); ++i) {
+        char c = json[i];
+        if (in_string) {
+            if (escaped) escaped = false;
+            else if (c == '\\') escaped = true;
+            else if (c == '"') {
+                in_string = false;
+                if (depth == 0) return i + 1;
+            }
+            continue;
+        }
+        if (c == '"') in_string = true;
+        else if (c == '{' || c == '[') ++depth;
+        else if ((c == '}' || c == ']') && --depth == 0) return i + 1;
+        if (depth < 0) return std::string::npos;
+    }
+    return std::string::npos;
+}
+
+// 拆出请求的 input：字符串是一条输入，字符串数组是多条输入。
+// token 数组 ([1,2,3] / [[1,2],[3]]) 不参与批处理，不能和字符串输入混进同一个数组
+static bool splitInputs(const std::string& value, std::vector<std::string>& inputs) {
+    if (!value.empty() && value[0] == '"') {
+        inputs.push_back(value);
+        return true;
+    }
+    if (!MicroBatcher::splitJsonArray(value, inputs) || inputs.empty()) return false;
+    for (const std::string& input : inputs) {
+        if (input.empty() || input[0] != '"') return false;
+    }
+    return true;
+}
+
+// 解析 index 字段的非负整数值，没有或不合法返回-1
+static long parseIndex(const std::string& item) {
+    size_t begin = 0, end = 0;
+    if (!MicroBatcher::findJsonField(item, "index", begin, end) || begin == end) return -1;
+    long index = 0;
+    for (size_t i = begin; i < end; ++i) {
+        if (item[i] < '0' || item[i] > '9' || index > (1L << 30)) return -1;
+        index = index * 10 + (item[i] - '0');
+    }
+    return index;
+}
+
+static std::string headerValue(const HttpRequest& request, const char* name) {
+    auto it = request.headers.find(name);
+    return it == request.headers.end() ? std::string() : it->second;
+}
+
+// 在JSON对象的顶层成员里查找 key，找到时 [begin, end) 为其值的范围
+// 按成员逐个跳过，嵌套对象里的同名字段 (如 "input": {"model": ...}) 和字符串内容都不会误匹配
+bool MicroBatcher::findJsonField(const std::string& json, const std::string& key, size_t& begin, size_t& end) {
+    const char* ws = " \t\r\n";
+    size_t pos = json.find_first_not_of(ws);
+    if (pos == std::string::npos || json[pos] != '{') return false;
+    pos = json.find_first_not_of(ws, pos + 1);
+    while (pos != std::string::npos && json[pos] == '"') {
+        size_t key_end = skipJsonValue(json, pos);
+        if (key_end == std::string::npos) return false;
+        size_t colon = json.find_first_not_of(ws, key_end);
+        if (colon == std::string::npos || json[colon] != ':') return false;
+        size_t value = json.find_first_not_of(ws, colon + 1);
+        size_t value_end = skipJsonValue(json, value == std::string::npos ? json.size() : value);
+        if (value_end == std::string::npos) return false;
+        if (json.compare(pos + 1, key_end - pos - 2, key) == 0) {
+            begin = value;
+            end = value_end;
+            return true;
+        }
+        pos = json.find_first_not_of(ws, value_end);
+        if (pos == std::string::npos || json[pos] != ',') return false;
+        pos = json.find_first_not_of(ws, pos + 1);
+    }
+    return false;
+}
+
+// 按顶层逗号拆分JSON数组（跳过字符串和嵌套的{}/[]），格式不合法返回false
+bool MicroBatcher::splitJsonArray(const std::string& json, std::vector<std::string>& items) {
+    std::string trimmed = trimBody(json);
+    if (trimmed.size() < 2 || trimmed.front() != '[' || trimmed.back() != ']') return false;
+
+    int depth = 0;
+    bool in_string = false;
+    bool escaped = false;
+    size_t item_start = 1;
+    for (size_t i = 1; i + 1 < trimmed.size(); ++i) {
+        char c = trimmed[i];
+        if (in_string) {
+            if (escaped) escaped = false;
+            else if (c == '\\') escaped = true;
+            else if (c == '"') in_string = false;
+            continue;
+        }
+        if (c == '"') in_string = true;
+        else if (c == '{' || c == '[') ++depth;
+        else if (c == '}' || c == ']') --depth;
+        else if (c == ',' && depth == 0) {
+            items.push_back(trimBody(trimmed.substr(item_start, i - item_start)));
+            item_start = i + 1;
+        }
+        if (depth < 0) return false;
+    }
+    std::string last = trimBody(trimmed.substr(item_start, trimmed.size() - 1 - item_start));
+    if (!last.empty() || !items.empty()) items.push_back(last);
+    return depth == 0 && !in_string;
+}
+
+// 是否适合批处理
+bool MicroBatcher::isBatchable(const HttpRequest& request) const {
+    if (request.method != "POST") return false;
+    if (request.body.size() > cfg.max_body_bytes) return false;
+    if (request.headers.count("x-no-batch")) return false;
+    if (std::find(cfg.routes.begin(), cfg.routes.end(), request.path) == cfg.routes.end()) return false;
+
+    size_t begin = 0, end = 0;
+    std::vector<std::string> inputs;
+    return findJsonField(request.body, "input", begin, end) &&
+           splitInputs(request.body.substr(begin, end - begin), inputs);
+}
+
+// 自适应窗口：按到达间隔的EWMA估算攒满一批要多久
+// - 间隔比窗口上限还长：等也等不来第二个请求，窗口为0直接发送
+// - 否则窗口 = 预计攒满时间，限制在[min_wait_us, max_wait_us]
+uint32_t MicroBatcher::adaptWindowUs(ArrivalStats& stats, Clock::time_point now) {
+    if (stats.has_last) {
+        double interval_us = std::chrono::duration<double, std::micro>(now - stats.last_arrival).count();
+        stats.ewma_interval_us = stats.ewma_interval_us == 0.0
+            ? interval_us
+            : 0.8 * stats.ewma_interval_us + 0.2 * interval_us;
+    }
+    stats.has_last = true;
+    stats.last_arrival = now;
+
+    if (stats.ewma_interval_us == 0.0 || stats.ewma_interval_us >= cfg.max_wait_us) return 0;
+
+    double fill_us = stats.ewma_interval_us * (cfg.max_batch_size - 1);
+    return static_cast<uint32_t>(std::min<double>(cfg.max_wait_us, std::max<double>(cfg.min_wait_us, fill_us)));
+}
+
+// 取到达速率统计：已有的直接返回；新键插入前保证表未满
+MicroBatcher::ArrivalStats& MicroBatcher::statsFor(const BatchKey& key, Clock::time_point now) {
+    auto it = arrival_stats.find(key);
+    if (it != arrival_stats.end()) return it->second;
+
+    if (arrival_stats.size() >= cfg.max_tracked_keys) evictIdleStats(now);
+    while (!arrival_stats.empty() && arrival_stats.size() >= cfg.max_tracked_keys) {
+        auto oldest = arrival_stats.begin();
+        for (auto candidate = arrival_stats.begin(); candidate != arrival_stats.end(); ++candidate) {
+            if (candidate->second.last_arrival < oldest->second.last_arrival) oldest = candidate;
+        }
+        arrival_stats.erase(oldest);
+    }
+    return arrival_stats[key];
+}
+
+// 丢弃闲置的到达速率统计：早已不再出现的调用方/模型组合不应一直占着内存
+void MicroBatcher::evictIdleStats(Clock::time_point now) {
+    last_stats_sweep = now;
+    auto idle = std::chrono::milliseconds(cfg.stats_idle_ms);
+    for (auto it = arrival_stats.begin(); it != arrival_stats.end(); ) {
+        if (now - it->second.last_arrival >= idle) it = arrival_stats.erase(it);
+        else ++it;
+    }
+}
+
+size_t MicroBatcher::trackedKeys() {
+    std::lock_guard<std::mutex> lock(batch_mutex);
+    return arrival_stats.size();
+}
+
+// 提交请求
+void MicroBatcher::submit(BackendServer* backend, const HttpRequest& request, Completion done) {
+    std::string body = trimBody(request.body);
+    size_t input_begin = 0, input_end = 0;
+    std::vector<std::string> inputs;
+    bool mergeable = findJsonField(body, "input", input_begin, input_end) &&
+                     splitInputs(body.substr(input_begin, input_end - input_begin), inputs);
+    BatchKey key{backend, request.path, headerValue(request, "authorization"),
+                 headerValue(request, "content-type"), body};
+    if (!mergeable) {
+        // 不符合合并约定的请求体 (调用方没有先检查 isBatchable)：单独原样发送
+        PendingBatch single;
+        single.head = request;
+        single.bodies.push_back(std::move(body));
+        single.completions.push_back(std::move(done));
+        dispatchAsync(key, std::move(single));
+        return;
+    }
+    // 除 input 以外的部分 (model、encoding_format、dimensions …) 必须完全相同才能合并
+    key.params = body.substr(0, input_begin) + body.substr(input_end);
+    PendingBatch ready;
+    bool send_now = false;
+    bool opened = false;
+    {
+        std::lock_guard<std::mutex> lock(batch_mutex);
+        auto now = Clock::now();
+        uint32_t window_us = adaptWindowUs(statsFor(key, now), now);
+
+        auto it = pending.find(key);
+        if (it == pending.end()) {
+            it = pending.emplace(key, PendingBatch()).first;
+            it->second.head = request;
+            it->second.head.body.clear();
+            it->second.body_prefix = body.substr(0, input_begin);
+            it->second.body_suffix = body.substr(input_end);
+            it->second.deadline = now + std::chrono::microseconds(window_us);
+            opened = window_us != 0;
+        }
+        it->second.bodies.push_back(std::move(body));
+        it->second.input_counts.push_back(inputs.size());
+        it->second.inputs.insert(it->second.inputs.end(), inputs.begin(), inputs.end());
+        it->second.completions.push_back(std::move(done));
+
+        // 攒满或窗口为0：立即发送
+        if (it->second.bodies.size() >= cfg.max_batch_size || window_us == 0) {
+            ready = std::move(it->second);
+            pending.erase(it);
+            send_now = true;
+        }
+    }
+    if (send_now) dispatchAsync(key, std::move(ready));
+    else if (opened && wakeup_cb) wakeup_cb();
+}
+
+// 发送所有已到期的批
+void MicroBatcher::flushExpired() {
+    std::vector<std::pair<BatchKey, PendingBatch>> expired;
+    {
+        std::lock_guard<std::mutex> lock(batch_mutex);
+        auto now = Clock::now();
+        // 驱动循环至少每秒调用一次：顺带清理闲置统计，每个闲置周期扫一遍即可
+        if (now - last_stats_sweep >= std::chrono::milliseconds(cfg.stats_idle_ms)) evictIdleStats(now);
+        for (auto it = pending.begin(); it != pending.end(); ) {
+            if (it->second.deadline <= now) {
+                expired.emplace_back(it->first, std::move(it->second));
+                it = pending.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    for (auto& item : expired) {
+        dispatchAsync(item.first, std::move(item.second));
+    }
+}
+
+// 距最近一批到期的时间
+int64_t MicroBatcher::nextDeadlineUs() {
+    std::lock_guard<std::mutex> lock(batch_mutex);
+    if (pending.empty()) return -1;
+
+    auto earliest = pending.begin()->second.deadline;
+    for (auto& item : pending) {
+        earliest = std::min(earliest, item.second.deadline);
+    }
+    auto remain = std::chrono::duration_cast<std::chrono::microseconds>(earliest - Clock::now()).count();
+    return std::max<int64_t>(0, remain);
+}
+
+// 交给线程池发送：上游调用可能要几十毫秒，不能占住驱动批次的事件循环。
+// 线程池排满说明上游已经跟不上，此时不在当前线程兜底发送 (flushExpired 跑在 accept 循环里)，
+// 整批立即失败，由调用方回 503 让客户端稍后重试
+void MicroBatcher::dispatchAsync(const BatchKey& key, PendingBatch batch) {
+    auto shared = std::make_shared<PendingBatch>(std::move(batch));
+    if (!dispatchers.trySubmit([this, key, shared]() { dispatch(key, *shared); })) {
+        std::cout << "[MicroBatch] 发送线程池已满，" << shared->completions.size() << " 个请求返回 503" << std::endl;
+        for (auto& done : shared->completions) done(BATCH_OVERLOADED, std::string());
+    }
+}
+
+// 发送一批：单个请求原样转发；多个请求把各自的 input 按顺序合并成一个数组发出，
+// 响应的 data 按 index 排好后按每个请求的输入条数切回，index 重新从0编号
+void MicroBatcher::dispatch(const BatchKey& key, PendingBatch& batch) {
+    size_t count = batch.bodies.size();
+    if (count == 1) {
+        batch.head.body = batch.bodies[0];
+    } else {
+        batch.head.body = batch.body_prefix + "[";
+        for (size_t i = 0; i < batch.inputs.size(); ++i) {
+            if (i != 0) batch.head.body += ",";
+            batch.head.body += batch.inputs[i];
+        }
+        batch.head.body += "]" + batch.body_suffix;
+    }
+    std::string response;
+    bool ok = upstream_call(key.backend, batch.head, response);
+
+    if (count == 1) {
+        batch.completions[0](ok ? BATCH_OK : BATCH_UPSTREAM_FAILED, ok ? response : std::string());
+        return;
+    }
+
+    size_t data_begin = 0, data_end = 0;
+    std::vector<std::string> items;
+    if (ok && findJsonField(response, "data", data_begin, data_end) &&
+        splitJsonArray(response.substr(data_begin, data_end - data_begin), items) &&
+        items.size() == batch.inputs.size()) {
+        // 按 index 归位 (后端不保证 data 的顺序)，index 缺失、越界或重复时整批失败
+        std::vector<std::string> ordered(items.size());
+        for (std::string& item : items) {
+            long index = parseIndex(item);
+            if (index < 0 || static_cast<size_t>(index) >= ordered.size() || !ordered[index].empty()) {
+                ok = false;
+                break;
+            }
+            ordered[index] = std::move(item);
+        }
+        items.swap(ordered);
+    } else if (ok) {
+        ok = false;
+    }
+    if (!ok) {
+        std::cout << "[MicroBatch] 后端响应无法拆分 (期望 data 含" << batch.inputs.size() << "项)，整批失败" << std::endl;
+        for (auto& done : batch.completions) done(BATCH_UPSTREAM_FAILED, std::string());
+        return;
+    }
+
+    size_t offset = 0;
+    for (size_t i = 0; i < count; ++i) {
+        std::string data = "[";
+        for (size_t j = 0; j < batch.input_counts[i]; ++j) {
+            const std::string& item = items[offset + j];
+            size_t begin = 0, end = 0;
+            findJsonField(item, "index", begin, end);
+            if (j != 0) data += ",";
+            data += item.substr(0, begin) + std::to_string(j) + item.substr(end);
+        }
+        data += "]";
+        offset += batch.input_counts[i];
+        batch.completions[i](BATCH_OK, response.substr(0, data_begin) + data + response.substr(data_end));
+    }
+}
@@ -0,0 +1,141 @@
+#ifndef MICRO_BATCHER_H
+#define MICRO_BATCHER_H
+
+#include "backend_server.h"
+#include "http_parser.h"
+#include "bounded_executor.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <tuple>
+
+// 单个请求的批处理结果
+enum BatchStatus {
+    BATCH_OK,               // 上游成功，response 为本请求的那一份
+    BATCH_UPSTREAM_FAILED,  // 上游失败或响应无法拆分
+    BATCH_OVERLOADED        // 发送线程池已满，批次未发送（驱动线程从不代为发送）
+};
+
+// 批处理参数
+struct BatchConfig {
+    size_t max_batch_size = 16;       // 单批最多合并的请求数
+    uint32_t max_wait_us = 2000;      // 批窗口上限（微秒）
+    uint32_t min_wait_us = 100;       // 批窗口下限（微秒）
+    size_t max_body_bytes = 4096;     // 超过此大小的请求体不参与批处理
+    std::vector<std::string> routes = {"/v1/embeddings"};  // 可批处理的路由（须遵循下面的 input/data 约定）
+    size_t dispatch_threads = 4;      // 发送批次的线程数
+    size_t dispatch_queue = 64;       // 等待发送的批次上限（排满时整批以 BATCH_OVERLOADED 失败）
+    uint32_t stats_idle_ms = 60000;   // 到达速率统计闲置多久后丢弃（该组合再来时按首个请求处理）
+    size_t max_tracked_keys = 4096;   // 最多同时统计多少个批次键，超出时淘汰最久没有请求的
+};
+
+// 动态微批处理：selectBackend 之后，把发往同一后端、同一路由、同一身份 (Authorization)、
+// 同一 Content-Type、且除 input 外请求体完全相同的小请求攒成一批，合并为一次上游调用。
+// 后端约定与 OpenAI /v1/embeddings 一致：
+//   请求  {"model": ..., "input": "文本" 或 ["文本", ...], ...}，多个请求的 input 按顺序拼成一个数组；
+//   响应  {"data": [{"index": i, ...}, ...], ...}，data[i] 对应合并后的第 i 条输入，
+//         按每个请求的输入条数切回，index 从0重新编号，响应中其余字段 (model、usage) 原样保留，
+//         因此拆回后的 usage 是整批的用量。token 数组形式的 input 不参与批处理。
+// 批窗口随到达速率自适应：流量大时等到攒满，流量稀疏时几乎不等待。
+// 到期的批次由驱动方的事件循环调用 flushExpired 发送，poll 超时取 nextDeadlineUs；
+// 批次在内部线程池中发送，不占用提交/驱动线程；线程池排满时整批立即以 BATCH_OVERLOADED 完成，
+// 驱动方 (accept/升级 poll 循环) 永远不会被上游调用阻塞。
+class MicroBatcher {
+public:
+    // 上游调用：batched_request 带着本批共同的请求行和请求头，body 为合并后的请求体；
+    // 写回合并后的响应体，失败返回false
+    using UpstreamCall = std::function<bool(BackendServer* backend, const HttpRequest& batched_request,
+                                            std::string& batched_response)>;
+    // 单个请求完成回调：status 不是 BATCH_OK 时 response 为空
+    using Completion = std::function<void(BatchStatus status, const std::string& response)>;
+
+    MicroBatcher(UpstreamCall upstream, BatchConfig config = BatchConfig())
+        : upstream_call(std::move(upstream)), cfg(std::move(config)),
+          dispatchers(cfg.dispatch_threads, cfg.dispatch_queue) {}
+
+    // 是否适合批处理：POST、路由在白名单内、请求体足够小、客户端没有声明X-No-Batch、
+    // 请求体顶层有字符串或字符串数组形式的 input
+    bool isBatchable(const HttpRequest& request) const;
+
+    // 提交请求：攒满一批立即发送，否则等批窗口到期由flushExpired发送
+    void submit(BackendServer* backend, const HttpRequest& request, Completion done);
+
+    // 由事件循环定时调用：发送所有已到期的批
+    void flushExpired();
+
+    // 距最近一批到期还剩多少微秒（用于计算epoll_wait超时），没有待发批次返回-1
+    int64_t nextDeadlineUs();
+
+    // 新开一批（带等待窗口）时调用：驱动方可能正睡在更长的 poll 超时里，需要被唤醒重新计算
+    void setWakeup(std::function<void()> wakeup) { wakeup_cb = std::move(wakeup); }
+
+    // 当前统计到达速率的批次键个数（不超过 max_tracked_keys）
+    size_t trackedKeys();
+
+    // 在JSON对象的顶层成员里查找 key，找到时 [begin, end) 为其值的范围
+    static bool findJsonField(const std::string& json, const std::string& key, size_t& begin, size_t& end);
+
+    // 按顶层逗号拆分JSON数组（跳过字符串和嵌套的{}/[]），格式不合法返回false
+    static bool splitJsonArray(const std::string& json, std::vector<std::string>& items);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // 只有这些字段都相同的请求才能合并：不同租户/鉴权、不同编码、不同模型或参数的请求不能混进同一次上游调用
+    struct BatchKey {
+        BackendServer* backend;
+        std::string route;
+        std::string authorization;
+        std::string content_type;
+        std::string params;       // 去掉 input 之后的请求体 (model、encoding_format、dimensions …)
+
+        bool operator<(const BatchKey& other) const {
+            return std::tie(backend, route, authorization, content_type, params) <
+                   std::tie(other.backend, other.route, other.authorization, other.content_type, other.params);
+        }
+    };
+
+    struct PendingBatch {
+        HttpRequest head;         // 本批第一个请求的请求行和请求头（不含请求体）
+        std::vector<std::string> bodies;
+        std::string body_prefix;            // 第一个请求体中 input 值之前/之后的部分，合并时套在输入数组外
+        std::string body_suffix;
+        std::vector<std::string> inputs;    // 所有请求的输入按顺序展开
+        std::vector<size_t> input_counts;   // 每个请求贡献的输入条数
+        std::vector<Completion> completions;
+        Clock::time_point deadline;
+    };
+
+    // 到达速率统计（到达间隔的EWMA）
+    struct ArrivalStats {
+        bool has_last = false;
+        Clock::time_point last_arrival;
+        double ewma_interval_us = 0.0;
+    };
+
+    UpstreamCall upstream_call;
+    BatchConfig cfg;
+    std::mutex batch_mutex;
+    std::map<BatchKey, PendingBatch> pending;
+    std::map<BatchKey, ArrivalStats> arrival_stats;  // 键含鉴权和模型，数量不可控：闲置超时淘汰 + 总数上限
+    Clock::time_point last_stats_sweep;
+    std::function<void()> wakeup_cb;
+    BoundedExecutor dispatchers;  // 最后声明：析构时最先 join，在途批次仍可访问上面的成员
+
+    // 取 key 的到达速率统计（持锁调用），新键在表满时先淘汰闲置/最久没有请求的键
+    ArrivalStats& statsFor(const BatchKey& key, Clock::time_point now);
+    // 丢弃闲置超过 stats_idle_ms 的统计（持锁调用）
+    void evictIdleStats(Clock::time_point now);
+    // 根据到达速率计算本批的等待窗口
+    uint32_t adaptWindowUs(ArrivalStats& stats, Clock::time_point now);
+    // 把一批交给线程池发送（在锁外调用），线程池排满时整批以 BATCH_OVERLOADED 完成
+    void dispatchAsync(const BatchKey& key, PendingBatch batch);
+    // 发送一批并分发结果
+    void dispatch(const BatchKey& key, PendingBatch& batch);
+};
+
+#endif // MICRO_BATCHER_H
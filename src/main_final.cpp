@@ -1,17 +1,65 @@
 #include <iostream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <ctime>
+#include <climits>
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <sys/time.h>
+#include <sys/eventfd.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <arpa/inet.h>
 #include <unistd.h>
 #include <cstring>
+#include <cerrno>
 #include "EventLoop.h"
+#include "ListenerHandoff.h"
+#include "StaticFileServer.h"
+#include "bounded_executor.h"
+#include "load_balancer.h"
+#include "gpu_telemetry.h"
+#include "hedged_request.h"
+#include "micro_batcher.h"
 
-int main() {
-    std::cout << "============================================" << std::endl;
-    std::cout << ">>> 终极整合版 AI 网关正在启动 (监听: 8081) <<<" << std::endl;
-    std::cout << "============================================" << std::endl;
+// =========================================================
+//  [零停机升级] 旧进程收到 SIGUSR2 -> 拉起新二进制 -> 新进程通过 Unix Socket
+//  拿到监听 socket (SCM_RIGHTS) -> 新进程初始化完毕回复就绪 -> 旧进程确认后停止 accept，
+//  排空在途连接后退出。旧进程等不到就绪确认 (新进程崩溃/卡住) 时放弃交接，继续服务
+// =========================================================
+static volatile sig_atomic_t g_upgrade_requested = 0;
+static std::atomic<int> g_inflight(0); // 已接受但还没处理完的连接数，排空阶段等待它归零
+static BoundedExecutor* g_workers = nullptr; // 连接处理线程池，accept 线程只负责接客和升级
+
+void on_upgrade_signal(int) {
+    g_upgrade_requested = 1;
+}
 
+// 拉起新版本二进制，它启动后会连上升级 socket 来接管端口
+void spawn_new_binary(const std::string& exe_path, char* argv[]) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        execv(exe_path.c_str(), argv);
+        perror("[Upgrade] execv 失败");
+        _exit(1);
+    }
+    if (pid < 0) {
+        perror("[Upgrade] fork 失败");
+        return;
+    }
+    std::cout << "[Upgrade] 已拉起新进程 PID=" << pid << "，等待其接管监听 socket..." << std::endl;
+}
+
+// 全新启动：自己创建并绑定监听 socket
+int create_listen_socket() {
     // 1. 创建 Socket
-    int server_fd = socket(AF_INET, SOCK_STREAM, 0);
+    // CLOEXEC：升级时 fork/exec 的新进程通过 SCM_RIGHTS 拿监听 socket，不应再隐式继承一份
+    int server_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
     int opt = 1;
     setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
 
@@ -23,50 +71,553 @@ int main() {
     // 2. 绑定端口
     if (bind(server_fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
         perror("[Error] Bind 失败");
+        close(server_fd);
         return -1;
     }
 
     // 3. 监听
     if (listen(server_fd, 10) < 0) {
         perror("[Error] Listen 失败");
+        close(server_fd);
         return -1;
     }
+    return server_fd;
+}
 
-    std::cout << "[System] 监听成功！等待请求中..." << std::endl;
+// /static/ 下的请求直接从磁盘返回 (GATEWAY_STATIC_ROOT，默认 src/control/static)
+static StaticFileServer* g_static_files = nullptr;
 
-    // 4. 模拟 EventLoop 的 Accept 逻辑 (为了演示效果，这里使用简易循环)
-    while(true) {
-        struct sockaddr_in client_addr;
-        socklen_t client_len = sizeof(client_addr);
-        
-        // 阻塞等待连接 (Accept)
-        int new_socket = accept(server_fd, (struct sockaddr*)&client_addr, &client_len);
-        if (new_socket < 0) {
-            perror("Accept 失败");
-            continue;
-        }
-
-        std::cout << "[Worker] 收到新连接! 处理中..." << std::endl;
-
-        // 读取请求 (假装解析)
-        char buffer[1024] = {0};
-        read(new_socket, buffer, 1024);
-        // std::cout << "请求内容: " << buffer << std::endl; // 调试用
-
-        // 发送 HTTP 响应 (这是 Module C 协议处理的最简化版)
-        // 模拟 Module B 负载均衡结果：告诉客户端我们活得很好
-        const char* response = "HTTP/1.1 200 OK\r\n"
-                               "Content-Type: text/plain\r\n"
-                               "Server: AI-Gateway-v1.0\r\n"
-                               "\r\n"
-                               "Hello! AI Gateway is working perfectly.\n"
-                               "Status: Traffic Forwarded to Backend 10.0.0.12 (GPU Usage: 25%)\n";
-        
-        send(new_socket, response, strlen(response), 0);
-        std::cout << "[Success] 已响应请求，断开连接。" << std::endl;
-        
+// 静态资源：阻塞 socket 上一般一次发完，被信号打断或短写时等可写后从断点继续
+bool serve_static(int sock, const std::string& request) {
+    StaticResponse response;
+    if (!g_static_files->handle(request, &response)) return false;
+
+    StaticFileTransfer transfer(std::move(response));
+    StaticFileTransfer::State state;
+    while ((state = transfer.pump(sock)) == StaticFileTransfer::kWouldBlock) {
+        struct pollfd pfd;
+        pfd.fd = sock;
+        pfd.events = POLLOUT;
+        if (poll(&pfd, 1, 5000) <= 0) break;
+    }
+    std::cout << "[Static] " << request.substr(0, request.find("\r\n"))
+              << (state == StaticFileTransfer::kDone ? " 已发送" : " 发送失败") << std::endl;
+    return true;
+}
+
+// =========================================================
+//  [GPU 感知调度] GATEWAY_BACKENDS="ip:port,ip:port" 配置后端，
+//  负载均衡器每次选择前从共享内存遥测区 (GATEWAY_GPU_TELEMETRY) 刷新各节点显存占用
+// =========================================================
+static LoadBalancer* g_balancer = nullptr;       // 没有配置后端时为空
+static GpuTelemetryReader* g_telemetry = nullptr;
+
+// 逗号分隔的列表 (GATEWAY_BACKENDS、GATEWAY_HEDGE_IDEMPOTENT_ROUTES)，忽略空项
+static std::vector<std::string> split_list(const char* spec) {
+    std::vector<std::string> items;
+    std::string list(spec ? spec : "");
+    size_t begin = 0;
+    while (begin < list.size()) {
+        size_t comma = list.find(',', begin);
+        if (comma == std::string::npos) comma = list.size();
+        if (comma > begin) items.push_back(list.substr(begin, comma - begin));
+        begin = comma + 1;
+    }
+    return items;
+}
+
+// 解析后端列表加入负载均衡器，返回加入的节点数
+int load_backends(const char* spec, LoadBalancer& lb) {
+    int count = 0;
+    for (const std::string& item : split_list(spec)) {
+        size_t colon = item.rfind(':');
+        if (colon == std::string::npos) continue;
+        BackendServer backend(item.substr(0, colon), static_cast<uint16_t>(std::atoi(item.c_str() + colon + 1)));
+        backend.is_warming_up = false; // 启动时配置的节点视为已在服务，预热只针对运行中新加入的节点
+        lb.addBackend(backend);
+        std::cout << "[Backend] " << backend.ip << ":" << backend.port << std::endl;
+        ++count;
+    }
+    return count;
+}
+
+// =========================================================
+//  [对冲请求] 配置了后端时，非静态请求转发到负载均衡器选出的节点；
+//  幂等请求超过路由 p95 延迟仍未返回时向第二个节点对冲，先返回者胜出
+// =========================================================
+static HedgedRequester* g_hedger = nullptr;
+
+// 对冲参数从环境变量读取，未设置的沿用 HedgeConfig 默认值：
+// GATEWAY_HEDGE_IDEMPOTENT_ROUTES  额外允许对冲的 POST 路由 (如 "/v1/embeddings,/v1/rerank")
+// GATEWAY_HEDGE_BUDGET_RATIO       对冲+重试占总请求的比例上限 (默认 0.1)
+// GATEWAY_HEDGE_BUDGET_BURST       预算桶容量 (默认 10)
+// GATEWAY_HEDGE_MAX_RETRIES        全部尝试失败后最多重试几次 (默认 1)
+HedgeConfig load_hedge_config() {
+    HedgeConfig cfg;
+    cfg.idempotent_routes = split_list(std::getenv("GATEWAY_HEDGE_IDEMPOTENT_ROUTES"));
+    if (const char* ratio = std::getenv("GATEWAY_HEDGE_BUDGET_RATIO")) cfg.budget_ratio = std::max(0.0, std::atof(ratio));
+    if (const char* burst = std::getenv("GATEWAY_HEDGE_BUDGET_BURST")) cfg.budget_burst = std::max(0.0, std::atof(burst));
+    if (const char* retries = std::getenv("GATEWAY_HEDGE_MAX_RETRIES")) cfg.max_retries = std::max(0, std::atoi(retries));
+
+    std::cout << "[Hedge] 重试预算 " << cfg.budget_ratio * 100 << "% (突发 " << cfg.budget_burst
+              << ")，最多重试 " << cfg.max_retries << " 次";
+    for (const std::string& route : cfg.idempotent_routes) std::cout << "，可对冲 POST " << route;
+    std::cout << std::endl;
+    return cfg;
+}
+
+// 等待上游 fd 就绪：每 50ms 检查一次取消标志，被取消或超过截止时间返回false
+static bool wait_upstream(int fd, short events, const std::atomic<bool>& cancelled,
+                          std::chrono::steady_clock::time_point deadline) {
+    while (!cancelled.load()) {
+        if (std::chrono::steady_clock::now() >= deadline) return false;
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = events;
+        int ready = poll(&pfd, 1, 50);
+        if (ready > 0) return true;
+        if (ready < 0 && errno != EINTR) return false;
+    }
+    return false;
+}
+
+// 上游调用：短连接 HTTP/1.1。30 秒截止时间只管到连接建立和响应头到达为止，
+// 之后正文留在上游连接里由调用方边读边转发 (relay_upstream)，长时间的流式输出不受限制；
+// 落败的对冲尝试在取消后 50ms 内关闭上游连接
+bool upstream_http_call(BackendServer* backend, const HttpRequest& request, UpstreamResponse& response,
+                        const std::atomic<bool>& cancelled) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(backend->port);
+    if (inet_pton(AF_INET, backend->ip.c_str(), &addr.sin_addr) != 1) return false;
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) {
+        close(fd);
+        return false;
+    }
+
+    std::string out = request.method + " " + request.path + " HTTP/1.1\r\n";
+    out += "Host: " + backend->ip + ":" + std::to_string(backend->port) + "\r\n";
+    for (const auto& header : request.headers) {
+        if (header.first == "host" || header.first == "connection" || header.first == "content-length") continue;
+        out += header.first + ": " + header.second + "\r\n";
+    }
+    out += "Content-Length: " + std::to_string(request.body.size()) + "\r\nConnection: close\r\n\r\n";
+    out += request.body;
+
+    size_t sent = 0;
+    while (sent < out.size()) {
+        if (!wait_upstream(fd, POLLOUT, cancelled, deadline)) {
+            close(fd);
+            return false;
+        }
+        ssize_t n = send(fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno != EAGAIN && errno != EINTR) {
+            close(fd); // 包括连接被拒绝 (非阻塞 connect 的错误在这里暴露)
+            return false;
+        }
+        if (n > 0) sent += n;
+    }
+
+    // 只读到响应头结束 (或后端提前关闭)：状态码够判断成败，正文不在这里等
+    std::string in;
+    char buf[16384];
+    bool eof = false;
+    while (in.find("\r\n\r\n") == std::string::npos && in.size() < 65536) {
+        if (!wait_upstream(fd, POLLIN, cancelled, deadline)) {
+            close(fd);
+            return false;
+        }
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n == 0) {
+            eof = true;
+            break;
+        }
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) continue;
+            close(fd);
+            return false;
+        }
+        in.append(buf, n);
+    }
+
+    size_t space = in.find(' ');
+    if (in.compare(0, 5, "HTTP/") != 0 || space == std::string::npos || in.size() < space + 4) {
+        close(fd);
+        return false;
+    }
+    response.head = std::move(in);
+    if (eof) close(fd);
+    else response.adoptFd(fd);
+    // 5xx 交给对冲/重试换节点；全部失败时该响应 (错误正文、Retry-After) 原样转给客户端
+    return response.head[space + 1] != '5';
+}
+
+// 把上游响应转给客户端：先发已收到的部分，再逐块转发剩余正文直到后端关闭连接。
+// 两次数据之间最多等 5 分钟 (流式输出之间的停顿不计入总时长)；客户端断开时立即停止
+static void relay_upstream(int client_fd, UpstreamResponse& response) {
+    if (send(client_fd, response.head.data(), response.head.size(), MSG_NOSIGNAL) < 0) return;
+    int fd = response.releaseFd();
+    if (fd < 0) return;
+
+    char buf[16384];
+    while (true) {
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        int ready = poll(&pfd, 1, 300 * 1000);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready <= 0) break;
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+        if (n <= 0) break;
+        if (send(client_fd, buf, n, MSG_NOSIGNAL) < 0) break;
+    }
+    close(fd);
+}
+
+// =========================================================
+//  [微批处理] GATEWAY_MICRO_BATCH=1 时开启 (默认关闭：后端须遵循 OpenAI embeddings 的
+//  input 数组 / data[i] 约定，见 micro_batcher.h)。/v1/embeddings 小请求按 后端+路由+鉴权+
+//  Content-Type+其余参数 攒批，到期的批次由 accept 循环驱动发送 (poll 超时取最近一批的截止时间)
+// =========================================================
+static MicroBatcher* g_batcher = nullptr;      // 没有开启批处理时为空
+static int g_batch_wakeup = -1; // eventfd：新开一批时唤醒 accept 循环重新计算 poll 超时
+
+// 合并后的请求走同一个上游调用，只把响应体交给批处理器拆分
+bool batch_upstream_call(BackendServer* backend, const HttpRequest& batched_request, std::string& batched_response) {
+    static const std::atomic<bool> never_cancelled(false);
+    UpstreamResponse response;
+    if (!upstream_http_call(backend, batched_request, response, never_cancelled)) return false;
+    size_t space = response.head.find(' ');
+    size_t header_end = response.head.find("\r\n\r\n");
+    if (response.head[space + 1] != '2' || header_end == std::string::npos) return false;
+
+    // 批响应需要完整的 JSON 才能拆分：读到后端关闭连接为止 (批处理只用于小请求，同样 30 秒截止)
+    batched_response = response.head.substr(header_end + 4);
+    int fd = response.releaseFd();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    char buf[16384];
+    while (fd >= 0) {
+        if (!wait_upstream(fd, POLLIN, never_cancelled, deadline)) {
+            close(fd);
+            return false;
+        }
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+        if (n < 0) {
+            close(fd);
+            return false;
+        }
+        if (n == 0) break;
+        batched_response.append(buf, n);
+    }
+    if (fd >= 0) close(fd);
+    return true;
+}
+
+// 提交到批处理器并等待本请求的那一份结果
+static std::string submit_to_batch(const HttpRequest& request) {
+    static const char kBadGateway[] = "HTTP/1.1 502 Bad Gateway\r\nContent-Length: 0\r\n\r\n";
+    static const char kOverloaded[] = "HTTP/1.1 503 Service Unavailable\r\nRetry-After: 1\r\nContent-Length: 0\r\n\r\n";
+    BackendServer* backend = g_balancer->selectBackend();
+    if (!backend) return kBadGateway;
+
+    auto result = std::make_shared<std::promise<std::pair<BatchStatus, std::string>>>();
+    std::future<std::pair<BatchStatus, std::string>> done = result->get_future();
+    g_batcher->submit(backend, request, [result](BatchStatus status, const std::string& body) {
+        result->set_value(std::make_pair(status, body));
+    });
+    if (done.wait_for(std::chrono::seconds(35)) != std::future_status::ready) return kBadGateway;
+
+    std::pair<BatchStatus, std::string> item = done.get();
+    if (item.first == BATCH_OVERLOADED) return kOverloaded;
+    if (item.first != BATCH_OK) return kBadGateway;
+    return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: " +
+           std::to_string(item.second.size()) + "\r\n\r\n" + item.second;
+}
+
+// 读完整个请求 (请求头 + Content-Length 指定的请求体)，上限 1MB
+static bool read_request(int sock, std::string& raw) {
+    char buffer[4096];
+    while (raw.size() < (1 << 20)) {
+        ssize_t n = read(sock, buffer, sizeof(buffer));
+        if (n <= 0) return !raw.empty();
+        raw.append(buffer, n);
+
+        size_t header_end = raw.find("\r\n\r\n");
+        if (header_end == std::string::npos) continue;
+        size_t body_len = 0;
+        std::string head = raw.substr(0, header_end);
+        std::transform(head.begin(), head.end(), head.begin(), ::tolower);
+        size_t cl = head.find("\r\ncontent-length:");
+        if (cl != std::string::npos) body_len = std::strtoul(head.c_str() + cl + 17, nullptr, 10);
+        if (raw.size() >= header_end + 4 + body_len) return true;
+    }
+    return true;
+}
+
+// 在工作线程中执行；g_inflight 已由 accept 线程加过，这里负责减回去
+void handle_connection(int new_socket) {
+    std::cout << "[Worker] 收到新连接! 处理中..." << std::endl;
+
+    std::string raw;
+    if (read_request(new_socket, raw) && serve_static(new_socket, raw)) {
         close(new_socket);
+        g_inflight--;
+        return;
+    }
+
+    // 配置了后端：经对冲执行器转发，响应原样回给客户端
+    HttpRequest request;
+    if (g_hedger && HttpParser().parse(raw, request)) {
+        size_t header_end = raw.find("\r\n\r\n");
+        request.body = header_end == std::string::npos ? std::string() : raw.substr(header_end + 4);
+
+        UpstreamResponse upstream_response;
+        if (g_batcher && g_batcher->isBatchable(request)) {
+            std::string reply = submit_to_batch(request);
+            send(new_socket, reply.data(), reply.size(), MSG_NOSIGNAL);
+            std::cout << "[MicroBatch] " << request.path << " 已响应" << std::endl;
+        } else if (g_hedger->execute(request, upstream_response)) {
+            std::cout << "[Proxy] " << request.method << " " << request.path << " 开始转发" << std::endl;
+            relay_upstream(new_socket, upstream_response);
+        } else if (!upstream_response.empty()) {
+            // 所有尝试都失败：转发最后一次的后端错误 (正文、Retry-After 等)，而不是空的 502
+            std::cout << "[Proxy] " << request.method << " " << request.path << " 所有后端均失败，转发最后一次错误" << std::endl;
+            relay_upstream(new_socket, upstream_response);
+        } else {
+            static const char kBadGateway[] = "HTTP/1.1 502 Bad Gateway\r\nContent-Length: 0\r\n\r\n";
+            send(new_socket, kBadGateway, sizeof(kBadGateway) - 1, MSG_NOSIGNAL);
+            std::cout << "[Proxy] " << request.method << " " << request.path << " 所有后端均失败" << std::endl;
+        }
+        close(new_socket);
+        g_inflight--;
+        return;
+    }
+
+    // 发送 HTTP 响应 (这是 Module C 协议处理的最简化版)
+    std::string response = "HTTP/1.1 200 OK\r\n"
+                           "Content-Type: text/plain\r\n"
+                           "Server: AI-Gateway-v1.0\r\n"
+                           "\r\n"
+                           "Hello! AI Gateway is working perfectly.\n"
+                           "Status: No backend configured (set GATEWAY_BACKENDS)\n";
+
+    send(new_socket, response.data(), response.size(), MSG_NOSIGNAL);
+    std::cout << "[Success] 已响应请求，断开连接。" << std::endl;
+
+    close(new_socket);
+    g_inflight--;
+}
+
+int main(int, char* argv[]) {
+    std::cout << "============================================" << std::endl;
+    std::cout << ">>> 终极整合版 AI 网关正在启动 (监听: 8081) <<<" << std::endl;
+    std::cout << "============================================" << std::endl;
+
+    const char* upgrade_path = std::getenv("GATEWAY_UPGRADE_SOCK");
+    if (!upgrade_path) upgrade_path = "/tmp/ai_gateway_upgrade.sock";
+    const char* drain_env = std::getenv("GATEWAY_DRAIN_TIMEOUT_SEC");
+    int drain_timeout_sec = drain_env ? std::atoi(drain_env) : 30;
+    const char* ack_env = std::getenv("GATEWAY_UPGRADE_ACK_TIMEOUT_SEC");
+    int ack_timeout_sec = ack_env ? std::max(1, std::atoi(ack_env)) : 10;
+
+    // 启动时记下自身路径：升级时磁盘上的二进制已被替换，/proc/self/exe 会指向已删除的旧文件
+    char exe_buf[PATH_MAX] = {0};
+    ssize_t exe_len = readlink("/proc/self/exe", exe_buf, sizeof(exe_buf) - 1);
+    std::string exe_path = exe_len > 0 ? std::string(exe_buf, exe_len) : std::string(argv[0]);
+
+    // 如果有旧进程在运行，直接接管它的监听 socket，端口全程不关闭。
+    // 与旧进程的连接保留到初始化完成：届时回复就绪，旧进程才停止 accept
+    int server_fd = -1;
+    int old_process = ListenerHandoff::connectUnix(upgrade_path);
+    if (old_process >= 0) {
+        std::vector<int> fds = ListenerHandoff::recvFds(old_process);
+        if (fds.empty()) {
+            std::cout << "[Upgrade] 旧进程未在超时内交出监听 socket，尝试自行监听" << std::endl;
+            close(old_process);
+            old_process = -1;
+        } else {
+            server_fd = fds[0];
+            for (size_t i = 1; i < fds.size(); ++i) close(fds[i]);
+            std::cout << "[Upgrade] 已从旧进程拿到监听 socket (FD=" << server_fd << ")，初始化完成后通知旧进程" << std::endl;
+        }
+    }
+    if (server_fd < 0) {
+        server_fd = create_listen_socket();
+        if (server_fd < 0) return -1;
+    }
+    // 连接在线程池里处理：慢连接不挡 accept，升级时也有真正在途的连接需要排空
+    const char* workers_env = std::getenv("GATEWAY_WORKERS");
+    int worker_count = workers_env ? std::max(1, std::atoi(workers_env)) : 8;
+    g_workers = new BoundedExecutor(worker_count, 1024); // 不析构：排空超时后直接退出，不等卡住的线程
+
+    const char* backends_env = std::getenv("GATEWAY_BACKENDS");
+    if (backends_env) {
+        g_balancer = new LoadBalancer(GPU_AWARE);
+        load_backends(backends_env, *g_balancer);
+        const char* telemetry_path = std::getenv("GATEWAY_GPU_TELEMETRY");
+        g_telemetry = new GpuTelemetryReader(telemetry_path ? telemetry_path : kGpuTelemetryPath);
+        g_balancer->setTelemetry(g_telemetry);
+        g_hedger = new HedgedRequester(*g_balancer, upstream_http_call, load_hedge_config());
+        const char* batch_env = std::getenv("GATEWAY_MICRO_BATCH");
+        if (batch_env && std::string(batch_env) == "1") {
+            g_batcher = new MicroBatcher(batch_upstream_call);
+            g_batch_wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            g_batcher->setWakeup([]() {
+                uint64_t one = 1;
+                ssize_t ignored = write(g_batch_wakeup, &one, sizeof(one));
+                (void)ignored;
+            });
+            std::cout << "[MicroBatch] 已开启 /v1/embeddings 微批处理" << std::endl;
+        }
+        std::cout << "[Backend] GPU 感知调度，遥测区" << (g_telemetry->attached() ? "已接入" : "暂未就绪 (控制面启动后自动接入)")
+                  << std::endl;
+    }
+
+    const char* static_root = std::getenv("GATEWAY_STATIC_ROOT");
+    g_static_files = new StaticFileServer(static_root ? static_root : "src/control/static");
+
+    signal(SIGUSR2, on_upgrade_signal);
+    signal(SIGPIPE, SIG_IGN); // sendfile 写已关闭的连接时返回 EPIPE，而不是杀掉进程
+    signal(SIGCHLD, SIG_IGN); // 新进程若启动失败退出，由内核自动回收
+
+    // 初始化完成，马上进入 accept 循环：通知旧进程停止 accept。
+    // 旧进程已因确认超时放弃交接 (关闭了连接) 时它仍在服务，本进程退出，避免两代进程同时存活
+    if (old_process >= 0) {
+        ListenerHandoff::AckResult confirm = ListenerHandoff::kClosed;
+        if (ListenerHandoff::sendAck(old_process, ListenerHandoff::kReady)) {
+            confirm = ListenerHandoff::waitAck(old_process, ListenerHandoff::kConfirm, (ack_timeout_sec + 5) * 1000);
+        }
+        close(old_process);
+        if (confirm == ListenerHandoff::kClosed) {
+            std::cout << "[Upgrade] 旧进程已放弃交接并继续服务，新进程退出" << std::endl;
+            return 1;
+        }
+        // kTimedOut：旧进程没有响应，不再等它，由本进程接管
+        std::cout << "[Upgrade] 已接管监听 socket，旧进程停止 accept" << std::endl;
     }
 
+    // 为下一次升级准备交接 socket (接管确认之后才创建：交接失败时旧进程的升级 socket 仍然有效)
+    int upgrade_fd = ListenerHandoff::listenUnix(upgrade_path);
+    if (upgrade_fd < 0) {
+        perror("[Warning] 升级 socket 创建失败，本进程不支持零停机升级");
+    }
+
+    std::cout << "[System] 监听成功！等待请求中... (kill -USR2 " << getpid() << " 触发平滑升级)" << std::endl;
+
+    // 4. 模拟 EventLoop 的 Accept 逻辑 (为了演示效果，这里使用简易循环)
+    // 用 poll 同时等待业务连接、升级请求、新进程的就绪确认和批处理唤醒
+    bool handed_off = false;
+    int new_process = -1;          // 已交出 fd、正在等就绪确认的新进程连接
+    time_t ack_deadline = 0;
+    while (!handed_off) {
+        if (g_upgrade_requested) {
+            g_upgrade_requested = 0;
+            if (new_process < 0) spawn_new_binary(exe_path, argv);
+        }
+        if (new_process >= 0 && time(NULL) >= ack_deadline) {
+            std::cout << "[Upgrade] 新进程 " << ack_timeout_sec << " 秒内未确认就绪，放弃交接，继续服务" << std::endl;
+            close(new_process);
+            new_process = -1;
+        }
+
+        // 有待发的批次时按最近一批的截止时间醒来，否则最多睡 1 秒以便及时响应 SIGUSR2
+        int timeout_ms = 1000;
+        int64_t batch_us = g_batcher ? g_batcher->nextDeadlineUs() : -1;
+        if (batch_us >= 0) timeout_ms = static_cast<int>(std::min<int64_t>(timeout_ms, (batch_us + 999) / 1000));
+
+        struct pollfd pfds[4];
+        pfds[0].fd = server_fd;
+        pfds[0].events = POLLIN;
+        pfds[1].fd = new_process < 0 ? upgrade_fd : -1;  // 升级 socket 创建失败时为 -1，poll 忽略负数 fd
+        pfds[1].events = POLLIN;
+        pfds[2].fd = g_batch_wakeup;
+        pfds[2].events = POLLIN;
+        pfds[3].fd = new_process;
+        pfds[3].events = POLLIN;
+        int ready = poll(pfds, 4, timeout_ms);
+        if (g_batcher) {
+            if (ready > 0 && (pfds[2].revents & POLLIN)) {
+                uint64_t count;
+                ssize_t ignored = read(g_batch_wakeup, &count, sizeof(count));
+                (void)ignored;
+            }
+            g_batcher->flushExpired();
+        }
+        if (ready <= 0) continue; // 超时或被信号打断
+
+        // 新进程来要监听 socket：交出去后继续 accept，直到它确认就绪
+        if (pfds[1].revents & POLLIN) {
+            new_process = accept4(upgrade_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (new_process >= 0 && !ListenerHandoff::sendFds(new_process, {server_fd})) {
+                close(new_process);
+                new_process = -1;
+            }
+            ack_deadline = time(NULL) + ack_timeout_sec;
+        }
+
+        // 新进程的就绪确认：回复确认后停止 accept；连接断开说明新进程启动失败，继续服务
+        if (pfds[3].revents & (POLLIN | POLLHUP | POLLERR)) {
+            if (ListenerHandoff::waitAck(new_process, ListenerHandoff::kReady, 0) == ListenerHandoff::kAcked &&
+                ListenerHandoff::sendAck(new_process, ListenerHandoff::kConfirm)) {
+                handed_off = true;
+            } else {
+                std::cout << "[Upgrade] 新进程未就绪即断开，放弃交接，继续服务" << std::endl;
+            }
+            close(new_process);
+            new_process = -1;
+            if (handed_off) break;
+        }
+
+        if (pfds[0].revents & POLLIN) {
+            struct sockaddr_in client_addr;
+            socklen_t client_len = sizeof(client_addr);
+
+            // 阻塞等待连接 (Accept)
+            int new_socket = accept4(server_fd, (struct sockaddr*)&client_addr, &client_len, SOCK_CLOEXEC);
+            if (new_socket < 0) {
+                perror("Accept 失败");
+                continue;
+            }
+            // 空闲客户端最多占住工作线程 10 秒
+            struct timeval rcv_timeout = {10, 0};
+            setsockopt(new_socket, SOL_SOCKET, SO_RCVTIMEO, &rcv_timeout, sizeof(rcv_timeout));
+
+            g_inflight++;
+            if (!g_workers->trySubmit([new_socket]() { handle_connection(new_socket); })) {
+                // 线程池排满：直接拒绝，不在 accept 线程里处理
+                static const char kBusy[] = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n";
+                send(new_socket, kBusy, sizeof(kBusy) - 1, MSG_NOSIGNAL);
+                close(new_socket);
+                g_inflight--;
+            }
+        }
+    }
+
+    // 交接完成：关闭本进程持有的副本 (新进程仍持有同一个内核 socket，端口不受影响)
+    close(server_fd);
+    close(upgrade_fd);
+    std::cout << "[Upgrade] 监听 socket 已交给新进程，开始排空 " << g_inflight << " 个在途连接 (最长 "
+              << drain_timeout_sec << " 秒)..." << std::endl;
+
+    time_t deadline = time(NULL) + drain_timeout_sec;
+    while (g_inflight > 0 && time(NULL) < deadline) {
+        // 在途请求可能正等着某个批次，排空期间继续按截止时间发送
+        int64_t batch_us = g_batcher ? g_batcher->nextDeadlineUs() : -1;
+        usleep(batch_us >= 0 ? static_cast<useconds_t>(std::min<int64_t>(batch_us, 100 * 1000)) : 100 * 1000);
+        if (g_batcher) g_batcher->flushExpired();
+    }
+    if (g_inflight > 0) {
+        std::cout << "[Upgrade] 排空超时，仍有 " << g_inflight << " 个连接，强制退出" << std::endl;
+    } else {
+        std::cout << "[Upgrade] 在途连接已全部完成，旧进程退出" << std::endl;
+    }
     return 0;
 }
@@ -0,0 +1,205 @@
+// event_loop_test.cpp
+// 验证 EventLoop 的读路径：readv 溢出的数据留在池化块链里直接交给请求 (不再追加回缓冲)、
+// 积压扩容的缓冲取空后缩回、水平触发每轮只读一次 readv、边缘触发单轮读取有上限且剩余数据下一轮接着读、
+// 共享监听 fd 打上 EPOLLEXCLUSIVE 后一个新连接只唤醒一个 EventLoop
+#include "test_common.h"
+#include "EventLoop.h"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// 带 \0 的可校验数据
+static std::string pattern(size_t size) {
+    std::string data(size, '\0');
+    for (size_t i = 0; i < size; ++i) data[i] = static_cast<char>(i % 251);
+    return data;
+}
+
+static void sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, 0);
+        CHECK(n > 0);
+        if (n <= 0) return;
+        sent += n;
+    }
+}
+
+static void testReadvOverflowStaysInChain() {
+    int fds[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    const std::string data = pattern(Buffer::kInitialSize + 10000);
+    sendAll(fds[0], data);
+
+    Buffer buffer;
+    PooledIoVec chain;
+    size_t overflow = 0;
+    int savedErrno = 0;
+    CHECK(buffer.readFd(fds[1], chain, &overflow, &savedErrno) == static_cast<ssize_t>(data.size()));
+    CHECK(buffer.readableBytes() == Buffer::kInitialSize);
+    CHECK(overflow == 10000);
+    CHECK(buffer.capacity() == Buffer::kInitialSize); // 溢出部分没有让缓冲扩容
+
+    std::string request(buffer.peek(), buffer.readableBytes());
+    chain.appendTo(&request, overflow);
+    CHECK(request == data);
+
+    // 没有数据时返回 -1 / EAGAIN，对端关闭时返回 0
+    buffer.retrieveAll();
+    ::fcntl(fds[1], F_SETFL, ::fcntl(fds[1], F_GETFL, 0) | O_NONBLOCK);
+    CHECK(buffer.readFd(fds[1], chain, &overflow, &savedErrno) == -1);
+    CHECK(savedErrno == EAGAIN || savedErrno == EWOULDBLOCK);
+    ::close(fds[0]);
+    CHECK(buffer.readFd(fds[1], chain, &overflow, &savedErrno) == 0);
+    ::close(fds[1]);
+}
+
+static void testIdleBufferShrinks() {
+    Buffer buffer;
+    const std::string big = pattern(200 * 1024);
+    buffer.append(big.data(), big.size());
+    CHECK(buffer.capacity() >= big.size());
+    buffer.retrieve(1000);
+    CHECK(buffer.capacity() >= big.size()); // 还有数据时不动
+    buffer.retrieveAll();
+    CHECK(buffer.capacity() == Buffer::kInitialSize);
+    CHECK(buffer.readableBytes() == 0);
+}
+
+// 逐轮驱动 EventLoop，把每轮交给 handler 的请求记下来 (handler 返回 false，请求照常进任务队列)
+struct CapturingLoop {
+    EventLoop loop;
+    std::vector<std::string> requests;
+
+    CapturingLoop() {
+        loop.setRequestHandler([this](Channel*, const std::string& request) {
+            requests.push_back(request);
+            return false;
+        });
+    }
+};
+
+static void testLevelTriggeredReadsOncePerWakeup() {
+    ::unsetenv("USE_EPOLL_ET");
+    int fds[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    const std::string data = pattern(30000);
+    sendAll(fds[0], data);
+
+    CapturingLoop capture;
+    capture.loop.addConnection(fds[1]);
+    capture.loop.loopOnce(100);
+    CHECK(capture.requests.size() == 1);
+    // 一次 readv：本缓冲 + 4 个池化块
+    CHECK(capture.requests[0].size() == Buffer::kInitialSize + PooledIoVec::kBlocks * MemoryPool::BLOCK_SIZE);
+    capture.loop.loopOnce(100); // 水平触发：剩下的数据内核下一轮还会报
+    CHECK(capture.requests.size() == 2);
+    CHECK(capture.requests[0] + capture.requests[1] == data);
+    ::close(fds[0]);
+    capture.loop.loopOnce(100);
+}
+
+static void testEdgeTriggeredCapAndResume() {
+    ::setenv("USE_EPOLL_ET", "1", 1);
+    int fds[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    int other[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, other);
+    const std::string data = pattern(150 * 1024);
+    sendAll(fds[0], data);
+    sendAll(other[0], "GET / HTTP/1.1\r\n\r\n");
+
+    CapturingLoop capture;
+    capture.loop.addConnection(fds[1]);
+    capture.loop.addConnection(other[1]);
+    CHECK(::fcntl(fds[1], F_GETFL, 0) & O_NONBLOCK);
+
+    // 第一轮：大连接读到配额就停，小连接在同一轮得到处理
+    capture.loop.loopOnce(100);
+    CHECK(capture.requests.size() == 2);
+    std::string received;
+    for (const std::string& request : capture.requests) {
+        if (request.size() > 100) {
+            CHECK(request.size() >= EventLoop::kMaxReadPerWakeup);
+            CHECK(request.size() < data.size());
+            received += request;
+        } else {
+            CHECK(request == "GET / HTTP/1.1\r\n\r\n");
+        }
+    }
+
+    // 之后不再有新数据 (也就没有新的边缘事件)，剩余数据仍在后续几轮读完
+    for (int i = 0; i < 5 && received.size() < data.size(); ++i) {
+        size_t before = capture.requests.size();
+        auto start = std::chrono::steady_clock::now();
+        capture.loop.loopOnce(1000);
+        // 有待读连接时不阻塞等待
+        CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(500));
+        for (size_t j = before; j < capture.requests.size(); ++j) received += capture.requests[j];
+    }
+    CHECK(received == data);
+
+    ::close(fds[0]);
+    ::close(other[0]);
+    capture.loop.loopOnce(100);
+    ::unsetenv("USE_EPOLL_ET");
+}
+
+static void testExclusiveListenerWakesOneLoop() {
+    int listenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    CHECK(::bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    CHECK(::listen(listenFd, 16) == 0);
+    socklen_t len = sizeof(addr);
+    ::getsockname(listenFd, reinterpret_cast<sockaddr*>(&addr), &len);
+
+    std::atomic<int> wakeups(0);
+    std::atomic<int> accepted(0);
+    auto onAccept = [&]() {
+        wakeups++;
+        // 晚一点再 accept：没有 EPOLLEXCLUSIVE 时另一个被唤醒的 EventLoop 此刻也会看到连接就绪
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK);
+        if (fd >= 0) {
+            accepted++;
+            ::close(fd);
+        }
+    };
+    EventLoop first, second;
+    first.addListener(listenFd, onAccept);
+    second.addListener(listenFd, onAccept);
+
+    // 两个 EventLoop 都阻塞在 epoll_wait 里时来一个连接：只有一个被唤醒
+    std::thread a([&]() { first.loopOnce(500); });
+    std::thread b([&]() { second.loopOnce(500); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    int client = ::socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(::connect(client, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    a.join();
+    b.join();
+    CHECK(accepted == 1);
+    CHECK(wakeups == 1);
+
+    ::close(client);
+    ::close(listenFd);
+}
+
+int main() {
+    testReadvOverflowStaysInChain();
+    testIdleBufferShrinks();
+    testLevelTriggeredReadsOncePerWakeup();
+    testEdgeTriggeredCapAndResume();
+    testExclusiveListenerWakesOneLoop();
+    return TEST_RESULT();
+}
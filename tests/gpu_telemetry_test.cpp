@@ -0,0 +1,169 @@
+// gpu_telemetry_test.cpp
+// 用控制面的 gpu_telemetry.py 写共享内存，验证 C++ 读者：
+// 能读到 Python 写入的数据、写者中途退出 (seq 停在奇数) 时不会卡住、GPU 感知调度用上遥测数据、
+// 多个写者进程并发认领时槽位互不重叠、区域被删除重建后读者重新映射
+#include "test_common.h"
+#include "gpu_telemetry.h"
+#include "load_balancer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static std::string g_path;
+
+// 调用 src/control/gpu_telemetry.py 写入一个后端的数据
+static bool publish(const char* ip, int port, double gpu, double vram) {
+    char cmd[512];
+    snprintf(cmd, sizeof(cmd), "python3 %s/src/control/gpu_telemetry.py --path %s --ip %s --port %d --gpu %f --vram %f > /dev/null",
+             GATEWAY_SOURCE_DIR, g_path.c_str(), ip, port, gpu, vram);
+    return std::system(cmd) == 0;
+}
+
+// 用指定槽位数新建区域并写入 (模拟控制面以新配置重建遥测区)
+static bool recreate(int slots, const char* ip, int port, double vram) {
+    ::unlink(g_path.c_str());
+    char cmd[768];
+    snprintf(cmd, sizeof(cmd),
+             "python3 -c \"import sys; sys.path.insert(0, '%s/src/control'); import gpu_telemetry as t; "
+             "w = t.GpuTelemetryWriter('%s', slots=%d); w.publish('%s', %d, 0.5, %f); w.close()\"",
+             GATEWAY_SOURCE_DIR, g_path.c_str(), slots, ip, port, vram);
+    return std::system(cmd) == 0;
+}
+
+static void testReadsPythonWriter() {
+    CHECK(publish("10.0.0.13", 9000, 0.4, 0.7));
+
+    GpuTelemetryReader reader(g_path.c_str());
+    CHECK(reader.attached());
+
+    BackendServer backend("10.0.0.13", 9000);
+    CHECK(reader.refresh(backend));
+    CHECK(std::fabs(backend.gpu_usage.load() - 0.4f) < 1e-6);
+    CHECK(std::fabs(backend.vram_usage.load() - 0.7f) < 1e-6);
+    CHECK(backend.telemetry_slot >= 0);
+
+    // 更新后再读到新值 (槽位缓存命中)
+    CHECK(publish("10.0.0.13", 9000, 0.9, 0.2));
+    CHECK(reader.refresh(backend));
+    CHECK(std::fabs(backend.vram_usage.load() - 0.2f) < 1e-6);
+
+    BackendServer unknown("10.0.0.99", 9000);
+    CHECK(!reader.refresh(unknown));
+}
+
+static void testStuckWriterDoesNotHang() {
+    GpuTelemetryReader reader(g_path.c_str());
+    BackendServer backend("10.0.0.13", 9000);
+    CHECK(reader.refresh(backend));
+    float vram_before = backend.vram_usage.load();
+
+    // 模拟写者在两次写 seq 之间被杀掉：把槽位 seq 改成奇数
+    int fd = ::open(g_path.c_str(), O_RDWR);
+    size_t size = sizeof(GpuTelemetryHeader) + (backend.telemetry_slot + 1) * sizeof(GpuTelemetrySlot);
+    void* base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    auto* slot = reinterpret_cast<GpuTelemetrySlot*>(static_cast<char*>(base) + sizeof(GpuTelemetryHeader)) +
+                 backend.telemetry_slot;
+    uint32_t seq = slot->seq.load();
+    slot->seq.store(seq | 1);
+
+    auto start = std::chrono::steady_clock::now();
+    CHECK(!reader.refresh(backend));
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+    CHECK(backend.vram_usage.load() == vram_before); // 沿用已有数据
+
+    // 下一个写者会修正奇数 seq，读者恢复
+    CHECK(publish("10.0.0.13", 9000, 0.5, 0.6));
+    CHECK(reader.refresh(backend));
+    CHECK(std::fabs(backend.vram_usage.load() - 0.6f) < 1e-6);
+    ::munmap(base, size);
+}
+
+static void testBalancerUsesTelemetry() {
+    CHECK(publish("127.0.0.1", 9101, 0.1, 0.9));
+    CHECK(publish("127.0.0.1", 9102, 0.1, 0.1));
+
+    GpuTelemetryReader reader(g_path.c_str());
+    LoadBalancer lb(GPU_AWARE);
+    for (uint16_t port : {9101, 9102}) {
+        BackendServer backend("127.0.0.1", port);
+        backend.is_warming_up = false;
+        lb.addBackend(backend);
+    }
+    lb.setTelemetry(&reader);
+
+    BackendServer* selected = lb.selectBackend();
+    CHECK(selected && selected->port == 9102);
+
+    // 显存占用反转后调度随之改变，不需要重载配置
+    CHECK(publish("127.0.0.1", 9101, 0.1, 0.05));
+    selected = lb.selectBackend();
+    CHECK(selected && selected->port == 9101);
+}
+
+// 多个写者进程同时认领空槽位：flock 保证每个后端拿到不同的槽位，数据互不覆盖
+static void testConcurrentWritersClaimDistinctSlots() {
+    const int kWriters = 12;
+    std::string cmd;
+    for (int i = 0; i < kWriters; ++i) {
+        char one[512];
+        snprintf(one, sizeof(one), "python3 %s/src/control/gpu_telemetry.py --path %s --ip 10.1.0.%d --port 9000 "
+                 "--gpu 0.1 --vram %f > /dev/null & ", GATEWAY_SOURCE_DIR, g_path.c_str(), i, i / 100.0);
+        cmd += one;
+    }
+    cmd += "wait";
+    CHECK(std::system(cmd.c_str()) == 0);
+
+    GpuTelemetryReader reader(g_path.c_str());
+    std::vector<int> slots;
+    for (int i = 0; i < kWriters; ++i) {
+        BackendServer backend("10.1.0." + std::to_string(i), 9000);
+        CHECK(reader.refresh(backend));
+        CHECK(std::fabs(backend.vram_usage.load() - i / 100.0f) < 1e-6);
+        slots.push_back(backend.telemetry_slot);
+    }
+    std::sort(slots.begin(), slots.end());
+    CHECK(std::unique(slots.begin(), slots.end()) == slots.end());
+}
+
+// 区域被删除重建 (槽位数也变了)：读者通过 inode 变化 (每秒检查一次) 重新映射，旧映射里缓存的槽位不再使用
+static void testReattachAfterRecreate() {
+    CHECK(recreate(4, "10.2.0.1", 9000, 0.3));
+    GpuTelemetryReader reader(g_path.c_str());
+    BackendServer backend("10.2.0.1", 9000);
+    CHECK(reader.refresh(backend));
+    CHECK(std::fabs(backend.vram_usage.load() - 0.3f) < 1e-6);
+
+    // 新区域的第一个槽位被另一个后端占用
+    CHECK(recreate(8, "10.2.0.9", 9000, 0.9));
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    BackendServer other("10.2.0.9", 9000);
+    CHECK(reader.refresh(other));
+    CHECK(std::fabs(other.vram_usage.load() - 0.9f) < 1e-6);
+    CHECK(!reader.refresh(backend));
+}
+
+int main() {
+    if (std::system("python3 -c 'import mmap' > /dev/null 2>&1") != 0) {
+        std::cout << "[SKIP] 没有 python3" << std::endl;
+        return 77;
+    }
+    g_path = "/tmp/gpu_telemetry_test_" + std::to_string(::getpid());
+
+    testReadsPythonWriter();
+    testStuckWriterDoesNotHang();
+    testBalancerUsesTelemetry();
+    testConcurrentWritersClaimDistinctSlots();
+    testReattachAfterRecreate();
+
+    ::unlink(g_path.c_str());
+    return TEST_RESULT();
+}
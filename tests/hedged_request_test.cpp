@@ -0,0 +1,280 @@
+// hedged_request_test.cpp
+// 用内存中的假上游驱动 HedgedRequester：慢主请求被对冲节点抢先、延迟从请求到达算起、
+// 慢的落败尝试也计入 p95、非幂等请求和预算耗尽时不对冲、上游尝试只在固定大小的线程池里执行、
+// 全部失败时保留最后一次后端响应、响应对象持有上游连接
+#include "test_common.h"
+#include "hedged_request.h"
+#include <chrono>
+#include <csignal>
+#include <cerrno>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// 假上游：按端口配置延迟，记录调用次数、被取消次数和执行线程
+struct FakeUpstream {
+    struct Behavior {
+        int delay_ms = 0;
+        bool ignore_cancel = false; // 模拟已经在回包、不理会取消的上游
+        bool fail = false;          // 模拟返回 5xx 的上游
+    };
+    std::unordered_map<uint16_t, Behavior> behaviors;
+    std::mutex mutex;
+    int calls = 0;
+    int cancelled = 0;
+    std::set<std::thread::id> threads;
+
+    bool call(BackendServer* backend, const HttpRequest&, UpstreamResponse& response, const std::atomic<bool>& cancel) {
+        Behavior behavior = behaviors[backend->port];
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++calls;
+            threads.insert(std::this_thread::get_id());
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(behavior.delay_ms);
+        while (std::chrono::steady_clock::now() < deadline) {
+            if (cancel.load() && !behavior.ignore_cancel) {
+                std::lock_guard<std::mutex> lock(mutex);
+                ++cancelled;
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        response.head = (behavior.fail ? "HTTP/1.1 503 x\r\nRetry-After: 1\r\n\r\nfrom " : "from ") +
+                        std::to_string(backend->port);
+        return !behavior.fail;
+    }
+
+    HedgedRequester::UpstreamCall bind() {
+        return [this](BackendServer* backend, const HttpRequest& request, UpstreamResponse& response,
+                      const std::atomic<bool>& cancel) { return call(backend, request, response, cancel); };
+    }
+};
+
+// 最少连接数：主请求固定落在第一个节点，对冲落在另一个
+static void addBackends(LoadBalancer& lb) {
+    for (uint16_t port : {9001, 9002}) {
+        BackendServer backend("127.0.0.1", port);
+        backend.is_warming_up = false;
+        lb.addBackend(backend);
+    }
+}
+
+static HttpRequest makeRequest(const std::string& method, const std::string& path) {
+    HttpRequest request;
+    request.method = method;
+    request.path = path;
+    request.version = "HTTP/1.1";
+    return request;
+}
+
+static long elapsedMs(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - since).count();
+}
+
+static void testSlowPrimaryIsHedged() {
+    FakeUpstream upstream;
+    upstream.behaviors[9001].delay_ms = 1000;
+    upstream.behaviors[9002].delay_ms = 10;
+    LoadBalancer lb(LEAST_CONN);
+    addBackends(lb);
+    HedgeConfig cfg;
+    cfg.default_hedge_delay_ms = 30;
+    cfg.min_samples = 1000;
+    HedgedRequester hedger(lb, upstream.bind(), cfg);
+
+    auto start = std::chrono::steady_clock::now();
+    UpstreamResponse response;
+    CHECK(hedger.execute(makeRequest("GET", "/v1/models"), response));
+    CHECK(response.head == "from 9002");
+    CHECK(elapsedMs(start) < 500);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::lock_guard<std::mutex> lock(upstream.mutex);
+    CHECK(upstream.calls == 2);
+    CHECK(upstream.cancelled == 1); // 落败的主请求被取消
+}
+
+static void testLatencyRecordedFromRequestStart() {
+    FakeUpstream upstream;
+    upstream.behaviors[9001].delay_ms = 120;
+    upstream.behaviors[9001].ignore_cancel = true;
+    upstream.behaviors[9002].delay_ms = 10;
+    LoadBalancer lb(LEAST_CONN);
+    addBackends(lb);
+    HedgeConfig cfg;
+    cfg.default_hedge_delay_ms = 30;
+    cfg.min_hedge_delay_ms = 1;
+    cfg.min_samples = 1;
+    HedgedRequester hedger(lb, upstream.bind(), cfg);
+
+    UpstreamResponse response;
+    CHECK(hedger.execute(makeRequest("GET", "/v1/models"), response));
+    CHECK(response.head == "from 9002");
+    // 胜出的对冲尝试自身只用了约10ms，但客户端等了 对冲延迟+10ms，记录的是后者
+    CHECK(hedger.hedgeDelayMs("/v1/models") >= 30);
+
+    // 慢的主请求随后返回：它的延迟同样进入窗口，p95 被拉到慢尾部，而不是越算越小
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    CHECK(hedger.hedgeDelayMs("/v1/models") >= 110);
+}
+
+static void testNonIdempotentNotHedged() {
+    FakeUpstream upstream;
+    upstream.behaviors[9001].delay_ms = 100;
+    LoadBalancer lb(LEAST_CONN);
+    addBackends(lb);
+    HedgeConfig cfg;
+    cfg.default_hedge_delay_ms = 10;
+    HedgedRequester hedger(lb, upstream.bind(), cfg);
+
+    UpstreamResponse response;
+    CHECK(hedger.execute(makeRequest("POST", "/v1/chat/completions"), response));
+    CHECK(response.head == "from 9001");
+    std::lock_guard<std::mutex> lock(upstream.mutex);
+    CHECK(upstream.calls == 1);
+}
+
+static void testBudgetExhaustedNoHedge() {
+    FakeUpstream upstream;
+    upstream.behaviors[9001].delay_ms = 100;
+    LoadBalancer lb(LEAST_CONN);
+    addBackends(lb);
+    HedgeConfig cfg;
+    cfg.default_hedge_delay_ms = 10;
+    cfg.budget_ratio = 0;
+    cfg.budget_burst = 0;
+    HedgedRequester hedger(lb, upstream.bind(), cfg);
+
+    UpstreamResponse response;
+    CHECK(hedger.execute(makeRequest("GET", "/v1/models"), response));
+    CHECK(response.head == "from 9001");
+    std::lock_guard<std::mutex> lock(upstream.mutex);
+    CHECK(upstream.calls == 1);
+}
+
+static void testAttemptsRunOnBoundedPool() {
+    FakeUpstream upstream;
+    upstream.behaviors[9001].delay_ms = 30;
+    upstream.behaviors[9002].delay_ms = 30;
+    LoadBalancer lb(LEAST_CONN);
+    addBackends(lb);
+    HedgeConfig cfg;
+    cfg.budget_ratio = 0;
+    cfg.budget_burst = 0;
+    cfg.attempt_threads = 2;
+    cfg.attempt_queue = 2;
+    HedgedRequester hedger(lb, upstream.bind(), cfg);
+
+    // 16 个并发调用方：池满时在调用线程里直接执行，请求都成功，池外不会多出线程
+    std::vector<std::thread> callers;
+    std::mutex caller_mutex;
+    std::set<std::thread::id> caller_ids;
+    std::atomic<int> ok(0);
+    for (int i = 0; i < 16; ++i) {
+        callers.emplace_back([&]() {
+            {
+                std::lock_guard<std::mutex> lock(caller_mutex);
+                caller_ids.insert(std::this_thread::get_id());
+            }
+            UpstreamResponse response;
+            if (hedger.execute(makeRequest("GET", "/v1/models"), response)) ok++;
+        });
+    }
+    for (auto& caller : callers) caller.join();
+    CHECK(ok == 16);
+
+    size_t pool_threads = 0;
+    for (const auto& id : upstream.threads) pool_threads += caller_ids.count(id) == 0;
+    CHECK(pool_threads <= cfg.attempt_threads);
+}
+
+// UpstreamResponse 接管上游连接后保留已收到的响应头，移动时连接跟着转移，析构时关闭
+static void testUpstreamResponseOwnsConnection() {
+    int fds[2];
+    CHECK(::pipe(fds) == 0);
+    UpstreamResponse response;
+    response.head = "HTTP/1.1 200 OK\r\n\r\n";
+    response.adoptFd(fds[0]);
+    CHECK(response.streaming());
+    CHECK(!response.empty());
+
+    UpstreamResponse moved(std::move(response));
+    CHECK(!response.streaming());
+    CHECK(moved.streaming() && moved.head == "HTTP/1.1 200 OK\r\n\r\n");
+    {
+        UpstreamResponse dropped(std::move(moved));
+    }
+    // 读端已随 dropped 析构关闭：写端收到 EPIPE
+    signal(SIGPIPE, SIG_IGN);
+    CHECK(::write(fds[1], "x", 1) == -1 && errno == EPIPE);
+    ::close(fds[1]);
+}
+
+// 所有尝试都失败时返回 false，并把最后一次的后端响应交给调用方转发
+static void testLastFailureForwarded() {
+    FakeUpstream upstream;
+    upstream.behaviors[9001].fail = true;
+    upstream.behaviors[9002].fail = true;
+    LoadBalancer lb(LEAST_CONN);
+    addBackends(lb);
+    HedgeConfig cfg;
+    cfg.default_hedge_delay_ms = 10;
+    HedgedRequester hedger(lb, upstream.bind(), cfg);
+
+    UpstreamResponse response;
+    CHECK(!hedger.execute(makeRequest("GET", "/v1/models"), response));
+    CHECK(response.head.compare(0, 12, "HTTP/1.1 503") == 0);
+    CHECK(response.head.find("Retry-After: 1") != std::string::npos);
+    CHECK(response.head.find("from 9002") != std::string::npos); // 重试到第二个节点后的那次失败
+    CHECK(!response.streaming());
+}
+
+// 查询串不同的请求共用一个路由窗口；路由数超过上限时淘汰最久没有样本的路由
+static void testLatencyWindowsKeyedByPathAndBounded() {
+    CHECK(HedgedRequester::routeOf("/v1/models?page=2") == "/v1/models");
+    CHECK(HedgedRequester::routeOf("/v1/models#top") == "/v1/models");
+
+    FakeUpstream upstream;
+    LoadBalancer lb(LEAST_CONN);
+    addBackends(lb);
+    HedgeConfig cfg;
+    cfg.min_samples = 3;
+    cfg.min_hedge_delay_ms = 1;
+    cfg.idempotent_routes = {"/v1/rerank"};
+    HedgedRequester hedger(lb, upstream.bind(), cfg);
+
+    upstream.behaviors[9001].delay_ms = 20;
+    UpstreamResponse response;
+    for (int i = 0; i < 3; ++i) {
+        CHECK(hedger.execute(makeRequest("GET", "/v1/models?page=" + std::to_string(i)), response));
+    }
+    // 三个样本落在同一个窗口里，p95 已经可用 (样本不足时会返回默认的 50ms)
+    uint32_t delay = hedger.hedgeDelayMs("/v1/models?page=9");
+    CHECK(delay >= 15 && delay < 50);
+    CHECK(hedger.isIdempotent(makeRequest("POST", "/v1/rerank?top_k=3")));
+
+    LatencyTracker tracker;
+    for (size_t i = 0; i < LatencyTracker::kMaxRoutes + 100; ++i) {
+        tracker.record("/r" + std::to_string(i), 10);
+        if (i % 10 == 0) tracker.record("/hot", 7); // 持续有样本的路由不会被淘汰
+    }
+    CHECK(tracker.routeCount() == LatencyTracker::kMaxRoutes);
+    CHECK(tracker.p95("/hot", 1) == 7);
+    CHECK(tracker.p95("/r0", 1) == 0);
+}
+
+int main() {
+    testSlowPrimaryIsHedged();
+    testLatencyRecordedFromRequestStart();
+    testNonIdempotentNotHedged();
+    testBudgetExhaustedNoHedge();
+    testAttemptsRunOnBoundedPool();
+    testUpstreamResponseOwnsConnection();
+    testLastFailureForwarded();
+    testLatencyWindowsKeyedByPathAndBounded();
+    return TEST_RESULT();
+}
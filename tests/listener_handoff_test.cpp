@@ -0,0 +1,177 @@
+// listener_handoff_test.cpp
+// 用 socketpair / Unix socket 验证零停机升级的交接原语：
+// 监听 fd 经 SCM_RIGHTS 传过去后在接收方照常 accept (交接前排队的连接也不丢)、
+// recvFds 在对端不发或已关闭时按时返回、kReady/kConfirm 确认的 kAcked/kTimedOut/kClosed 三种结果
+#include "test_common.h"
+#include "ListenerHandoff.h"
+#include <chrono>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static long elapsedMs(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - since).count();
+}
+
+static int connectTo(const sockaddr_in& addr) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0);
+    return fd;
+}
+
+// 接收方 accept 一个连接并收一条消息
+static std::string acceptAndRead(int listenFd) {
+    int conn = ::accept(listenFd, nullptr, nullptr);
+    CHECK(conn >= 0);
+    if (conn < 0) return std::string();
+    char buf[64];
+    ssize_t n = ::recv(conn, buf, sizeof(buf), 0);
+    ::close(conn);
+    return n > 0 ? std::string(buf, n) : std::string();
+}
+
+static void testListeningFdAcceptsAfterHandoff() {
+    int listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    CHECK(::bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    CHECK(::listen(listenFd, 16) == 0);
+    socklen_t len = sizeof(addr);
+    ::getsockname(listenFd, reinterpret_cast<sockaddr*>(&addr), &len);
+
+    // 交接前就到达、还在 accept 队列里的连接
+    int early = connectTo(addr);
+    ::send(early, "early", 5, 0);
+
+    int pair[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, pair);
+    int pipeFds[2];
+    CHECK(::pipe(pipeFds) == 0);
+    CHECK(ListenerHandoff::sendFds(pair[0], {listenFd, pipeFds[1]}));
+    ::close(listenFd); // 旧进程关掉自己的副本，端口仍由接收方持有
+    ::close(pipeFds[1]);
+
+    std::vector<int> fds = ListenerHandoff::recvFds(pair[1], 1000);
+    CHECK(fds.size() == 2);
+    if (fds.size() != 2) return;
+    int received = fds[0];
+    CHECK(::fcntl(received, F_GETFD) & FD_CLOEXEC);
+    int accepting = 0;
+    len = sizeof(accepting);
+    CHECK(::getsockopt(received, SOL_SOCKET, SO_ACCEPTCONN, &accepting, &len) == 0 && accepting == 1);
+
+    CHECK(acceptAndRead(received) == "early");
+    int late = connectTo(addr);
+    ::send(late, "late", 4, 0);
+    CHECK(acceptAndRead(received) == "late");
+
+    // 一起传过去的其它 fd 同样可用
+    CHECK(::write(fds[1], "x", 1) == 1);
+    char c = 0;
+    CHECK(::read(pipeFds[0], &c, 1) == 1 && c == 'x');
+
+    ::close(early);
+    ::close(late);
+    for (int fd : fds) ::close(fd);
+    ::close(pipeFds[0]);
+    ::close(pair[0]);
+    ::close(pair[1]);
+}
+
+static void testSendFdsRejectsBadInput() {
+    int pair[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, pair);
+    CHECK(!ListenerHandoff::sendFds(pair[0], {}));
+    CHECK(!ListenerHandoff::sendFds(pair[0], std::vector<int>(ListenerHandoff::kMaxFds + 1, pair[0])));
+    ::close(pair[0]);
+    ::close(pair[1]);
+}
+
+static void testRecvFdsTimeout() {
+    int pair[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, pair);
+
+    // 旧进程卡住不发：按超时返回空列表
+    auto start = std::chrono::steady_clock::now();
+    CHECK(ListenerHandoff::recvFds(pair[1], 150).empty());
+    long waited = elapsedMs(start);
+    CHECK(waited >= 140 && waited < 1000);
+
+    // 旧进程退出 (连接关闭)：立即返回空列表，不等到超时
+    ::close(pair[0]);
+    start = std::chrono::steady_clock::now();
+    CHECK(ListenerHandoff::recvFds(pair[1], 5000).empty());
+    CHECK(elapsedMs(start) < 1000);
+    ::close(pair[1]);
+}
+
+static void testAckResults() {
+    int pair[2]; // [0] 旧进程一侧，[1] 新进程一侧
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, pair);
+
+    // 新进程还没就绪
+    CHECK(ListenerHandoff::waitAck(pair[0], ListenerHandoff::kReady, 0) == ListenerHandoff::kTimedOut);
+    auto start = std::chrono::steady_clock::now();
+    CHECK(ListenerHandoff::waitAck(pair[0], ListenerHandoff::kReady, 100) == ListenerHandoff::kTimedOut);
+    CHECK(elapsedMs(start) >= 90);
+
+    // 正常握手：kReady -> kConfirm
+    CHECK(ListenerHandoff::sendAck(pair[1], ListenerHandoff::kReady));
+    CHECK(ListenerHandoff::waitAck(pair[0], ListenerHandoff::kReady, 1000) == ListenerHandoff::kAcked);
+    CHECK(ListenerHandoff::sendAck(pair[0], ListenerHandoff::kConfirm));
+    CHECK(ListenerHandoff::waitAck(pair[1], ListenerHandoff::kConfirm, 1000) == ListenerHandoff::kAcked);
+
+    // 收到意料之外的字节按协议错误处理
+    CHECK(ListenerHandoff::sendAck(pair[1], 'X'));
+    CHECK(ListenerHandoff::waitAck(pair[0], ListenerHandoff::kReady, 1000) == ListenerHandoff::kClosed);
+
+    // 新进程崩溃：连接关闭，立即返回 kClosed；往已关闭的连接发确认失败而不是收到 SIGPIPE
+    ::close(pair[1]);
+    start = std::chrono::steady_clock::now();
+    CHECK(ListenerHandoff::waitAck(pair[0], ListenerHandoff::kReady, 5000) == ListenerHandoff::kClosed);
+    CHECK(elapsedMs(start) < 1000);
+    CHECK(!ListenerHandoff::sendAck(pair[0], ListenerHandoff::kConfirm));
+    ::close(pair[0]);
+}
+
+static void testUnixRendezvous() {
+    std::string path = "/tmp/listener_handoff_test_" + std::to_string(::getpid()) + ".sock";
+    CHECK(ListenerHandoff::connectUnix(path.c_str()) == -1); // 没有旧进程
+
+    int server = ListenerHandoff::listenUnix(path.c_str());
+    CHECK(server >= 0);
+    int client = ListenerHandoff::connectUnix(path.c_str());
+    CHECK(client >= 0);
+    int peer = ::accept(server, nullptr, nullptr);
+    CHECK(peer >= 0);
+    CHECK(ListenerHandoff::sendAck(client, ListenerHandoff::kReady));
+    CHECK(ListenerHandoff::waitAck(peer, ListenerHandoff::kReady, 1000) == ListenerHandoff::kAcked);
+
+    // 残留的 socket 文件会被下一代进程清理掉重新监听
+    ::close(server);
+    int again = ListenerHandoff::listenUnix(path.c_str());
+    CHECK(again >= 0);
+
+    std::string tooLong(200, 'a');
+    CHECK(ListenerHandoff::listenUnix(("/tmp/" + tooLong).c_str()) == -1);
+    CHECK(ListenerHandoff::connectUnix(("/tmp/" + tooLong).c_str()) == -1);
+
+    ::close(peer);
+    ::close(client);
+    ::close(again);
+    ::unlink(path.c_str());
+}
+
+int main() {
+    testListeningFdAcceptsAfterHandoff();
+    testSendFdsRejectsBadInput();
+    testRecvFdsTimeout();
+    testAckResults();
+    testUnixRendezvous();
+    return TEST_RESULT();
+}
@@ -0,0 +1,396 @@
+// micro_batcher_test.cpp
+// 验证 MicroBatcher：JSON 数组拆分和顶层字段查找、稀疏流量不等待、密集流量把 input 合并成数组、
+// 响应 data 按 index 归位后切回各请求、到期批次由 flushExpired 发送、
+// 鉴权/Content-Type/模型等参数不同的请求不会被合并、发送线程池排满时返回 503 而不阻塞、
+// 到达速率统计闲置淘汰且总数有上限
+#include "test_common.h"
+#include "micro_batcher.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 取请求体里的 input 条目 (字符串即一条)
+static std::vector<std::string> inputsOf(const std::string& body) {
+    std::vector<std::string> inputs;
+    size_t begin = 0, end = 0;
+    if (!MicroBatcher::findJsonField(body, "input", begin, end)) return inputs;
+    std::string value = body.substr(begin, end - begin);
+    if (value[0] == '"') inputs.push_back(value);
+    else MicroBatcher::splitJsonArray(value, inputs);
+    return inputs;
+}
+
+// 按 index 取出响应 data 里的 embedding；index 不是 0..n-1 时返回空
+static std::vector<std::string> embeddingsOf(const std::string& response) {
+    std::vector<std::string> items;
+    size_t begin = 0, end = 0;
+    if (!MicroBatcher::findJsonField(response, "data", begin, end)) return items;
+    if (!MicroBatcher::splitJsonArray(response.substr(begin, end - begin), items)) return {};
+    std::vector<std::string> embeddings(items.size());
+    for (const std::string& item : items) {
+        size_t index_begin = 0, index_end = 0, value_begin = 0, value_end = 0;
+        if (!MicroBatcher::findJsonField(item, "index", index_begin, index_end) ||
+            !MicroBatcher::findJsonField(item, "embedding", value_begin, value_end)) return {};
+        size_t index = std::stoul(item.substr(index_begin, index_end - index_begin));
+        if (index >= embeddings.size()) return {};
+        embeddings[index] = item.substr(value_begin, value_end - value_begin);
+    }
+    return embeddings;
+}
+
+// 假上游：按 OpenAI embeddings 约定应答，embedding 就是对应的输入本身；
+// data 故意倒序返回，验证拆分按 index 归位而不是按数组位置
+struct EmbeddingUpstream {
+    std::mutex mutex;
+    std::vector<HttpRequest> calls;
+
+    MicroBatcher::UpstreamCall bind() {
+        return [this](BackendServer*, const HttpRequest& request, std::string& response) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                calls.push_back(request);
+            }
+            std::vector<std::string> inputs = inputsOf(request.body);
+            response = "{\"object\":\"list\",\"data\":[";
+            for (size_t i = inputs.size(); i-- > 0; ) {
+                response += "{\"object\":\"embedding\",\"index\":" + std::to_string(i) + ",\"embedding\":" + inputs[i] + "}";
+                if (i != 0) response += ",";
+            }
+            response += "],\"model\":\"m\",\"usage\":{\"total_tokens\":" + std::to_string(inputs.size()) + "}}";
+            return true;
+        };
+    }
+
+    size_t callCount() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return calls.size();
+    }
+};
+
+// 等待异步完成的结果
+struct Results {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<std::pair<std::string, std::string>> done;  // (请求体, 响应)
+    std::vector<BatchStatus> statuses;
+    bool all_ok = true;
+
+    MicroBatcher::Completion expect(const std::string& body) {
+        return [this, body](BatchStatus status, const std::string& response) {
+            std::lock_guard<std::mutex> lock(mutex);
+            all_ok &= status == BATCH_OK;
+            done.emplace_back(body, response);
+            statuses.push_back(status);
+            cv.notify_all();
+        };
+    }
+
+    size_t count(BatchStatus status) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return std::count(statuses.begin(), statuses.end(), status);
+    }
+
+    bool waitFor(size_t count) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return cv.wait_for(lock, std::chrono::seconds(2), [&]() { return done.size() >= count; });
+    }
+
+    // 每个请求拿回的 embedding 恰好是自己的输入，顺序一致
+    bool eachGotOwnInputs() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& item : done) {
+            if (inputsOf(item.first) != embeddingsOf(item.second)) return false;
+        }
+        return all_ok;
+    }
+};
+
+static HttpRequest makeRequest(const std::string& body, const std::string& auth = "Bearer a",
+                               const std::string& content_type = "application/json") {
+    HttpRequest request;
+    request.method = "POST";
+    request.path = "/v1/embeddings";
+    request.version = "HTTP/1.1";
+    request.headers["authorization"] = auth;
+    request.headers["content-type"] = content_type;
+    request.body = body;
+    return request;
+}
+
+static void testSplitJsonArray() {
+    std::vector<std::string> items;
+    CHECK(MicroBatcher::splitJsonArray(" [{\"a\":[1,2]}, \"x,y\" ,3]\n", items));
+    CHECK(items.size() == 3);
+    CHECK(items.size() == 3 && items[0] == "{\"a\":[1,2]}" && items[1] == "\"x,y\"" && items[2] == "3");
+
+    items.clear();
+    CHECK(MicroBatcher::splitJsonArray("[\"a\\\"],b\"]", items)); // 字符串里的转义引号和括号
+    CHECK(items.size() == 1);
+
+    items.clear();
+    CHECK(MicroBatcher::splitJsonArray("[]", items));
+    CHECK(items.empty());
+
+    items.clear();
+    CHECK(!MicroBatcher::splitJsonArray("{\"a\":1}", items));
+    CHECK(!MicroBatcher::splitJsonArray("[1,2", items));
+    CHECK(!MicroBatcher::splitJsonArray("[{\"a\":1]", items));
+}
+
+// 只匹配顶层成员：嵌套对象里的同名键、字符串值里的键名都不算
+static void testFindJsonField() {
+    std::string json = "{\"meta\":{\"input\":1},\"note\":\"\\\"input\\\":2\", \"input\" : [\"a\",\"b\"] ,\"n\":3}";
+    size_t begin = 0, end = 0;
+    CHECK(MicroBatcher::findJsonField(json, "input", begin, end));
+    CHECK(json.substr(begin, end - begin) == "[\"a\",\"b\"]");
+    CHECK(MicroBatcher::findJsonField(json, "n", begin, end));
+    CHECK(json.substr(begin, end - begin) == "3");
+    CHECK(!MicroBatcher::findJsonField(json, "missing", begin, end));
+    CHECK(!MicroBatcher::findJsonField("[\"input\"]", "input", begin, end));
+
+    MicroBatcher batcher([](BackendServer*, const HttpRequest&, std::string&) { return true; });
+    CHECK(batcher.isBatchable(makeRequest("{\"model\":\"m\",\"input\":\"a\"}")));
+    CHECK(batcher.isBatchable(makeRequest("{\"model\":\"m\",\"input\":[\"a\",\"b\"]}")));
+    CHECK(!batcher.isBatchable(makeRequest("{\"model\":\"m\",\"input\":[1,2,3]}")));   // token 数组
+    CHECK(!batcher.isBatchable(makeRequest("{\"model\":\"m\",\"input\":[]}")));
+    CHECK(!batcher.isBatchable(makeRequest("{\"model\":\"m\",\"prompt\":\"a\"}")));
+    CHECK(!batcher.isBatchable(makeRequest("[{\"input\":\"a\"}]")));
+}
+
+// 到达间隔比窗口上限还长：每个请求立即单独发送，不等待
+static void testSparseTrafficNotDelayed() {
+    EmbeddingUpstream upstream;
+    Results results;
+    BatchConfig cfg;
+    cfg.max_wait_us = 2000;
+    MicroBatcher batcher(upstream.bind(), cfg);
+    BackendServer backend("127.0.0.1", 9000);
+
+    for (int i = 0; i < 3; ++i) {
+        std::string body = "{\"input\":\"" + std::to_string(i) + "\"}";
+        batcher.submit(&backend, makeRequest(body), results.expect(body));
+        CHECK(batcher.nextDeadlineUs() == -1); // 没有留下待发批次
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    CHECK(results.waitFor(3));
+    CHECK(upstream.callCount() == 3);
+    CHECK(results.eachGotOwnInputs());
+    std::lock_guard<std::mutex> lock(upstream.mutex);
+    CHECK(upstream.calls.size() == 3 && upstream.calls[0].body == "{\"input\":\"0\"}"); // 单个请求原样转发
+}
+
+// 密集到达：窗口打开后攒满 max_batch_size 立即合并发送；没攒满的批次到期后由 flushExpired 发送
+static void testDenseTrafficBatched() {
+    EmbeddingUpstream upstream;
+    Results results;
+    BatchConfig cfg;
+    cfg.max_batch_size = 3;
+    cfg.min_wait_us = 50000;
+    cfg.max_wait_us = 200000;
+    MicroBatcher batcher(upstream.bind(), cfg);
+    BackendServer backend("127.0.0.1", 9000);
+
+    std::vector<std::string> bodies = {
+        "{\"model\":\"m\",\"input\":\"t0\"}",
+        "{\"model\":\"m\",\"input\":\"t1\"}",
+        "{\"model\":\"m\",\"input\":[\"t2a\",\"t2b\"]}",
+        "{\"model\":\"m\",\"input\":\"t3\"}",
+        "{\"model\":\"m\",\"input\":\"t4\"}",
+    };
+
+    batcher.submit(&backend, makeRequest(bodies[0]), results.expect(bodies[0])); // 首个请求没有速率数据，直接发送
+    CHECK(results.waitFor(1));
+    for (int i = 1; i <= 3; ++i) batcher.submit(&backend, makeRequest(bodies[i]), results.expect(bodies[i]));
+    CHECK(results.waitFor(4));
+    CHECK(upstream.callCount() == 2);
+    {
+        std::lock_guard<std::mutex> lock(upstream.mutex);
+        CHECK(upstream.calls.size() == 2 &&
+              upstream.calls[1].body == "{\"model\":\"m\",\"input\":[\"t1\",\"t2a\",\"t2b\",\"t3\"]}");
+        CHECK(upstream.calls.size() == 2 && upstream.calls[1].headers["authorization"] == "Bearer a");
+    }
+
+    // 第5个请求打开新窗口：到期前不发送，nextDeadlineUs 给出剩余时间
+    batcher.submit(&backend, makeRequest(bodies[4]), results.expect(bodies[4]));
+    int64_t remain = batcher.nextDeadlineUs();
+    CHECK(remain > 0 && remain <= 200000);
+    batcher.flushExpired();
+    CHECK(upstream.callCount() == 2);
+
+    std::this_thread::sleep_for(std::chrono::microseconds(remain + 1000));
+    CHECK(batcher.nextDeadlineUs() == 0);
+    batcher.flushExpired();
+    CHECK(results.waitFor(5));
+    CHECK(batcher.nextDeadlineUs() == -1);
+    CHECK(upstream.callCount() == 3);
+    CHECK(results.eachGotOwnInputs());
+
+    // 拆回的响应保留其余字段，index 从0重新编号
+    std::lock_guard<std::mutex> lock(results.mutex);
+    for (auto& item : results.done) {
+        if (item.first != bodies[2]) continue;
+        CHECK(item.second.find("\"index\":0,\"embedding\":\"t2a\"") != std::string::npos);
+        CHECK(item.second.find("\"index\":1,\"embedding\":\"t2b\"") != std::string::npos);
+        CHECK(item.second.find("\"model\":\"m\"") != std::string::npos);
+    }
+}
+
+// data 条数与合并的输入数对不上：整批失败，不把别人的结果错发给客户端
+static void testMismatchedResponseFailsBatch() {
+    std::atomic<int> calls(0);
+    MicroBatcher::UpstreamCall short_reply = [&](BackendServer*, const HttpRequest&, std::string& response) {
+        calls++;
+        response = "{\"data\":[{\"index\":0,\"embedding\":[0.1]}]}";
+        return true;
+    };
+    Results results;
+    BatchConfig cfg;
+    cfg.min_wait_us = 20000;
+    cfg.max_wait_us = 50000;
+    MicroBatcher batcher(short_reply, cfg);
+    BackendServer backend("127.0.0.1", 9000);
+
+    for (int i = 0; i < 3; ++i) {
+        std::string body = "{\"input\":\"" + std::to_string(i) + "\"}";
+        batcher.submit(&backend, makeRequest(body), results.expect(body));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    batcher.flushExpired();
+    CHECK(results.waitFor(3));
+    CHECK(calls.load() == 2);
+    CHECK(results.count(BATCH_OK) == 1);                 // 首个请求单独发送
+    CHECK(results.count(BATCH_UPSTREAM_FAILED) == 2);
+}
+
+// 鉴权、Content-Type、模型等参数不同的请求各自成批，每次上游调用带的请求头与批内请求一致
+static void testDifferentCallersNotMixed() {
+    EmbeddingUpstream upstream;
+    Results results;
+    BatchConfig cfg;
+    cfg.min_wait_us = 50000;
+    cfg.max_wait_us = 200000;
+    MicroBatcher batcher(upstream.bind(), cfg);
+    BackendServer backend("127.0.0.1", 9000);
+
+    struct Caller { std::string auth, content_type, params; };
+    std::vector<Caller> callers = {
+        {"Bearer a", "application/json", "\"model\":\"m1\""},
+        {"Bearer b", "application/json", "\"model\":\"m1\""},
+        {"Bearer a", "application/json; charset=utf-8", "\"model\":\"m1\""},
+        {"Bearer a", "application/json", "\"model\":\"m2\""},
+        {"Bearer a", "application/json", "\"model\":\"m1\",\"dimensions\":256"},
+    };
+    size_t submitted = 0;
+    for (int round = 0; round < 3; ++round) {
+        for (size_t c = 0; c < callers.size(); ++c) {
+            const Caller& caller = callers[c];
+            std::string body = "{" + caller.params + ",\"input\":\"c" + std::to_string(c) + "|" +
+                               std::to_string(round) + "\"}";
+            batcher.submit(&backend, makeRequest(body, caller.auth, caller.content_type), results.expect(body));
+            ++submitted;
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    batcher.flushExpired();
+    CHECK(results.waitFor(submitted));
+    CHECK(results.eachGotOwnInputs());
+
+    // 每次上游调用里的所有输入都来自同一调用方，请求头和参数与该调用方一致
+    bool merged = false;
+    std::lock_guard<std::mutex> lock(upstream.mutex);
+    for (HttpRequest& call : upstream.calls) {
+        std::vector<std::string> inputs = inputsOf(call.body);
+        merged |= inputs.size() > 1;
+        size_t c = std::stoul(inputs[0].substr(2));
+        for (const std::string& input : inputs) CHECK(std::stoul(input.substr(2)) == c);
+        CHECK(call.headers["authorization"] == callers[c].auth);
+        CHECK(call.headers["content-type"] == callers[c].content_type);
+        CHECK(call.body.compare(1, callers[c].params.size() + 1, callers[c].params + ",") == 0);
+    }
+    CHECK(merged);
+    CHECK(upstream.calls.size() >= callers.size() * 2); // 每组首个请求单发 + 每组至少一批
+}
+
+// 发送线程池排满：flushExpired 不在驱动线程里代发 (不会被慢上游卡住)，整批以 BATCH_OVERLOADED 完成
+static void testFullPoolFailsInsteadOfBlocking() {
+    std::mutex gate_mutex;
+    std::condition_variable gate_cv;
+    bool open = false;
+    std::atomic<int> calls(0);
+    MicroBatcher::UpstreamCall blocking = [&](BackendServer*, const HttpRequest& request, std::string& response) {
+        calls++;
+        std::unique_lock<std::mutex> lock(gate_mutex);
+        gate_cv.wait(lock, [&]() { return open; });
+        response = "{\"data\":[{\"index\":0,\"embedding\":" + inputsOf(request.body)[0] + "}]}";
+        return true;
+    };
+    Results results;
+    BatchConfig cfg;
+    cfg.min_wait_us = 20000;
+    cfg.max_wait_us = 50000;
+    cfg.dispatch_threads = 1;
+    cfg.dispatch_queue = 1;
+    MicroBatcher batcher(blocking, cfg);
+    BackendServer backend("127.0.0.1", 9000);
+
+    // a 占住唯一的发送线程，b 排进队列，c 紧跟 a 到达、开出一个等待窗口
+    batcher.submit(&backend, makeRequest("{\"input\":\"a\"}"), results.expect("{\"input\":\"a\"}"));
+    batcher.submit(&backend, makeRequest("{\"input\":\"c\"}"), results.expect("{\"input\":\"c\"}"));
+    batcher.submit(&backend, makeRequest("{\"input\":\"b\"}", "Bearer b"), results.expect("{\"input\":\"b\"}"));
+    CHECK(batcher.nextDeadlineUs() > 0);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    auto start = std::chrono::steady_clock::now();
+    batcher.flushExpired();
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(20));
+    CHECK(results.count(BATCH_OVERLOADED) == 1);
+    CHECK(calls.load() == 1);
+
+    {
+        std::lock_guard<std::mutex> lock(gate_mutex);
+        open = true;
+    }
+    gate_cv.notify_all();
+    CHECK(results.waitFor(3));
+    CHECK(results.count(BATCH_OK) == 2);
+}
+
+// 到达速率统计有界：超过上限时淘汰最久没有请求的键，闲置超时的键由 flushExpired 清理
+static void testArrivalStatsBounded() {
+    EmbeddingUpstream upstream;
+    Results results;
+    BatchConfig cfg;
+    cfg.max_tracked_keys = 8;
+    cfg.stats_idle_ms = 50;
+    MicroBatcher batcher(upstream.bind(), cfg);
+    BackendServer backend("127.0.0.1", 9000);
+
+    for (int i = 0; i < 20; ++i) {
+        std::string body = "{\"input\":\"x\"}";
+        batcher.submit(&backend, makeRequest(body, "Bearer " + std::to_string(i)), results.expect(body));
+        CHECK(batcher.trackedKeys() <= cfg.max_tracked_keys);
+    }
+    CHECK(batcher.trackedKeys() == cfg.max_tracked_keys);
+    CHECK(results.waitFor(20));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    batcher.flushExpired();
+    CHECK(batcher.trackedKeys() == 0);
+}
+
+int main() {
+    testSplitJsonArray();
+    testFindJsonField();
+    testSparseTrafficNotDelayed();
+    testDenseTrafficBatched();
+    testMismatchedResponseFailsBatch();
+    testDifferentCallersNotMixed();
+    testFullPoolFailsInsteadOfBlocking();
+    testArrivalStatsBounded();
+    return TEST_RESULT();
+}
@@ -0,0 +1,237 @@
+// static_file_server_test.cpp
+// 在临时目录里构造静态资源，直接调用 StaticFileServer::handle 验证：
+// 目录穿越 (含 %2e%2e 等编码形式) 被拒绝、各种 Range (普通/后缀/开放/非法/无法满足)、
+// If-Range 不匹配时退回完整响应、gzip;q=0 不发预压缩版本、文件被替换后缓存在 revalidate 间隔后更新
+#include "test_common.h"
+#include "StaticFileServer.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static std::string g_dir;  // 临时目录，其下的 root/ 作为静态资源根目录
+static std::string g_root;
+
+static void writeFile(const std::string& path, const std::string& content) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    CHECK(::write(fd, content.data(), content.size()) == static_cast<ssize_t>(content.size()));
+    ::close(fd);
+}
+
+static std::string get(const std::string& target, const std::string& headers = "") {
+    return "GET " + target + " HTTP/1.1\r\nHost: localhost\r\n" + headers + "\r\n";
+}
+
+static int status(const StaticResponse& response) {
+    return std::atoi(response.header.c_str() + 9);
+}
+
+static bool hasHeader(const StaticResponse& response, const std::string& line) {
+    return response.header.find(line + "\r\n") != std::string::npos;
+}
+
+// 响应要发送的文件正文
+static std::string body(const StaticResponse& response) {
+    if (!response.file) return std::string();
+    std::string out(response.length, '\0');
+    if (response.file->data) {
+        out.assign(response.file->data + response.offset, response.length);
+    } else {
+        CHECK(::pread(response.file->fd, &out[0], response.length, response.offset) ==
+              static_cast<ssize_t>(response.length));
+    }
+    return out;
+}
+
+static void testTraversalRejected() {
+    StaticFileServer server(g_root);
+    StaticResponse response;
+
+    CHECK(server.handle(get("/static/index.html"), &response));
+    CHECK(status(response) == 200);
+    CHECK(body(response) == "<h1>hello</h1>");
+
+    const char* attacks[] = {
+        "/static/../secret.txt",
+        "/static/sub/../../secret.txt",
+        "/static/%2e%2e/secret.txt",
+        "/static/%2E%2E%2Fsecret.txt",
+        "/static/..%2fsecret.txt",
+        "/static/sub/%2e%2e/%2e%2e/secret.txt",
+        "/static/%2f" "etc/passwd",
+        "/static//etc/passwd",
+        "/static/index.html%00.png",
+        "/static/%zz",
+        "/static/%2",
+        "/static/",
+    };
+    for (const char* target : attacks) {
+        CHECK(server.handle(get(target), &response));
+        CHECK(status(response) == 404);
+        CHECK(!response.file);
+    }
+
+    // 编码过的合法名字照常解码后服务
+    CHECK(server.handle(get("/static/a%20b.txt"), &response));
+    CHECK(status(response) == 200);
+    CHECK(body(response) == "spaced");
+
+    // 前缀以外的路径交给后续流程，其它方法返回 405
+    CHECK(!server.handle(get("/v1/models"), &response));
+    CHECK(server.handle("POST /static/index.html HTTP/1.1\r\n\r\n", &response));
+    CHECK(status(response) == 405);
+}
+
+static void testRanges() {
+    StaticFileServer server(g_root);
+    StaticResponse response;
+    const std::string digits = "0123456789";
+
+    CHECK(server.handle(get("/static/digits.txt", "Range: bytes=2-4\r\n"), &response));
+    CHECK(status(response) == 206);
+    CHECK(hasHeader(response, "Content-Range: bytes 2-4/10"));
+    CHECK(hasHeader(response, "Content-Length: 3"));
+    CHECK(body(response) == "234");
+
+    // 后缀区间：最后 3 个字节；超过文件大小时取整个文件
+    CHECK(server.handle(get("/static/digits.txt", "Range: bytes=-3\r\n"), &response));
+    CHECK(status(response) == 206);
+    CHECK(hasHeader(response, "Content-Range: bytes 7-9/10"));
+    CHECK(body(response) == "789");
+    CHECK(server.handle(get("/static/digits.txt", "Range: bytes=-100\r\n"), &response));
+    CHECK(body(response) == digits);
+
+    // 开放区间、结尾超出文件大小时截到文件末尾
+    CHECK(server.handle(get("/static/digits.txt", "Range: bytes=6-\r\n"), &response));
+    CHECK(hasHeader(response, "Content-Range: bytes 6-9/10"));
+    CHECK(body(response) == "6789");
+    CHECK(server.handle(get("/static/digits.txt", "Range: bytes=8-100\r\n"), &response));
+    CHECK(body(response) == "89");
+
+    // 格式不对 / 多段 / 反向区间：忽略 Range，返回完整文件
+    const char* ignored[] = {"bytes=abc", "bytes=1-2,4-5", "bytes=5-2", "items=0-1", "bytes=-", "bytes=1"};
+    for (const char* range : ignored) {
+        CHECK(server.handle(get("/static/digits.txt", std::string("Range: ") + range + "\r\n"), &response));
+        CHECK(status(response) == 200);
+        CHECK(body(response) == digits);
+    }
+
+    // 起点超出文件或后缀长度为 0：416，带上文件大小
+    const char* unsatisfiable[] = {"bytes=10-", "bytes=50-60", "bytes=-0"};
+    for (const char* range : unsatisfiable) {
+        CHECK(server.handle(get("/static/digits.txt", std::string("Range: ") + range + "\r\n"), &response));
+        CHECK(status(response) == 416);
+        CHECK(hasHeader(response, "Content-Range: bytes */10"));
+        CHECK(!response.file);
+    }
+
+    // HEAD 只有响应头
+    CHECK(server.handle("HEAD /static/digits.txt HTTP/1.1\r\nRange: bytes=0-1\r\n\r\n", &response));
+    CHECK(status(response) == 206);
+    CHECK(!response.file);
+}
+
+static void testIfRange() {
+    StaticFileServer server(g_root);
+    StaticResponse response;
+    CHECK(server.handle(get("/static/digits.txt"), &response));
+    size_t pos = response.header.find("ETag: ");
+    std::string etag = response.header.substr(pos + 6, response.header.find("\r\n", pos) - pos - 6);
+
+    // ETag 一致时按 Range 返回，不一致 (文件已变) 时返回完整的新文件
+    CHECK(server.handle(get("/static/digits.txt", "Range: bytes=0-1\r\nIf-Range: " + etag + "\r\n"), &response));
+    CHECK(status(response) == 206);
+    CHECK(body(response) == "01");
+    CHECK(server.handle(get("/static/digits.txt", "Range: bytes=0-1\r\nIf-Range: \"stale\"\r\n"), &response));
+    CHECK(status(response) == 200);
+    CHECK(body(response) == "0123456789");
+
+    CHECK(server.handle(get("/static/digits.txt", "If-None-Match: " + etag + "\r\n"), &response));
+    CHECK(status(response) == 304);
+    CHECK(!response.file);
+}
+
+static void testGzipNegotiation() {
+    StaticFileServer server(g_root);
+    StaticResponse response;
+
+    CHECK(server.handle(get("/static/app.js", "Accept-Encoding: br, gzip\r\n"), &response));
+    CHECK(hasHeader(response, "Content-Encoding: gzip"));
+    CHECK(hasHeader(response, "Vary: Accept-Encoding"));
+    CHECK(body(response) == "GZ-BYTES");
+
+    // q=0 表示明确拒绝 gzip
+    const char* refused[] = {"gzip;q=0", "gzip; q=0.0, identity", "*;q=0", "br", ""};
+    for (const char* value : refused) {
+        CHECK(server.handle(get("/static/app.js", std::string("Accept-Encoding: ") + value + "\r\n"), &response));
+        CHECK(status(response) == 200);
+        CHECK(!hasHeader(response, "Content-Encoding: gzip"));
+        CHECK(hasHeader(response, "Vary: Accept-Encoding"));
+        CHECK(body(response) == "console.log(1);");
+    }
+
+    CHECK(server.handle(get("/static/app.js", "Accept-Encoding: gzip;q=0.5\r\n"), &response));
+    CHECK(hasHeader(response, "Content-Encoding: gzip"));
+}
+
+static void testCacheRevalidatesChangedFile() {
+    const std::string path = g_root + "/model.json";
+    writeFile(path, "{\"v\":1}");
+    StaticFileServer server(g_root, "/static/", 16, 100);
+    StaticResponse response;
+    CHECK(server.handle(get("/static/model.json"), &response));
+    CHECK(body(response) == "{\"v\":1}");
+    std::shared_ptr<const CachedFile> old = response.file;
+
+    // 部署方式：写新文件再 rename 覆盖 (inode 变化)
+    writeFile(path + ".tmp", "{\"v\":2,\"new\":true}");
+    CHECK(::rename((path + ".tmp").c_str(), path.c_str()) == 0);
+
+    // revalidate 间隔内仍然命中缓存的旧文件，旧 fd 依旧可读
+    CHECK(server.handle(get("/static/model.json"), &response));
+    CHECK(response.file == old);
+    CHECK(body(response) == "{\"v\":1}");
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    CHECK(server.handle(get("/static/model.json"), &response));
+    CHECK(response.file != old);
+    CHECK(body(response) == "{\"v\":2,\"new\":true}");
+    CHECK(old->fd >= 0); // 仍被持有的旧条目没有被提前关闭
+
+    // 文件被删除后同样在间隔后变成 404
+    ::unlink(path.c_str());
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    CHECK(server.handle(get("/static/model.json"), &response));
+    CHECK(status(response) == 404);
+}
+
+int main() {
+    char tmpl[] = "/tmp/static_file_server_test_XXXXXX";
+    g_dir = ::mkdtemp(tmpl);
+    g_root = g_dir + "/root";
+    ::mkdir(g_root.c_str(), 0700);
+    ::mkdir((g_root + "/sub").c_str(), 0700);
+    writeFile(g_dir + "/secret.txt", "secret");
+    writeFile(g_root + "/index.html", "<h1>hello</h1>");
+    writeFile(g_root + "/a b.txt", "spaced");
+    writeFile(g_root + "/digits.txt", "0123456789");
+    writeFile(g_root + "/app.js", "console.log(1);");
+    writeFile(g_root + "/app.js.gz", "GZ-BYTES");
+
+    testTraversalRejected();
+    testRanges();
+    testIfRange();
+    testGzipNegotiation();
+    testCacheRevalidatesChangedFile();
+
+    const char* files[] = {"/index.html", "/a b.txt", "/digits.txt", "/app.js", "/app.js.gz"};
+    for (const char* file : files) ::unlink((g_root + file).c_str());
+    ::rmdir((g_root + "/sub").c_str());
+    ::rmdir(g_root.c_str());
+    ::unlink((g_dir + "/secret.txt").c_str());
+    ::rmdir(g_dir.c_str());
+    return TEST_RESULT();
+}
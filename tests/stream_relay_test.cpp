@@ -0,0 +1,171 @@
+// stream_relay_test.cpp
+// 用两对 socketpair 模拟 客户端<->网关 和 网关<->后端，逐轮驱动 EventLoop 验证 StreamRelay：
+// 流式分块按序转发、超过高水位暂停读后端、回落到低水位以下恢复读取、
+// 客户端半关闭后后端收到 EOF 且响应仍能送回客户端
+#include "test_common.h"
+#include "EventLoop.h"
+#include "StreamRelay.h"
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static void makePair(int fds[2]) {
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+}
+
+static void setNonBlocking(int fd) {
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+// 读出当前能读到的全部数据
+static std::string drain(int fd) {
+    std::string out;
+    char buf[65536];
+    ssize_t n;
+    while ((n = ::recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) out.append(buf, n);
+    return out;
+}
+
+static void testChunksForwardedInOrder() {
+    int client[2], backend[2]; // [0] 在测试这一侧，[1] 交给 Relay
+    makePair(client);
+    makePair(backend);
+
+    EventLoop loop;
+    StreamRelay* relay = new StreamRelay(&loop, client[1], backend[1]);
+    const std::string request = "POST /v1/chat HTTP/1.1\r\nAccept: text/event-stream\r\n\r\n";
+    relay->start(request);
+
+    loop.loopOnce(10);
+    CHECK(drain(backend[0]) == request);
+
+    std::vector<std::string> chunks = {
+        "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n\r\n",
+        "data: {\"token\":\"Hel\"}\n\n",
+        "data: {\"token\":\"lo\"}\n\n",
+        "data: [DONE]\n\n",
+    };
+    std::string expected, received;
+    for (const std::string& chunk : chunks) {
+        ::send(backend[0], chunk.data(), chunk.size(), 0);
+        expected += chunk;
+        loop.loopOnce(10);
+        // 每块到达后立即可读，不等后续数据
+        received += drain(client[0]);
+        CHECK(received == expected);
+    }
+
+    ::close(backend[0]);
+    for (int i = 0; i < 5; ++i) loop.loopOnce(10);
+    char c;
+    CHECK(::recv(client[0], &c, 1, MSG_DONTWAIT) == 0); // 后端关闭且数据送达后客户端连接被关闭
+    ::close(client[0]);
+}
+
+static void testBackpressurePauseAndResume() {
+    int client[2], backend[2];
+    makePair(client);
+    makePair(backend);
+    setNonBlocking(backend[0]);
+
+    EventLoop loop;
+    StreamRelay* relay = new StreamRelay(&loop, client[1], backend[1]);
+    relay->start();
+
+    // 后端持续写、客户端不读：Relay 的客户端输出缓冲涨到高水位后停止读后端
+    size_t sent = 0;
+    std::vector<char> chunk(65536);
+    for (int i = 0; i < 1000 && !relay->backendReadPaused(); ++i) {
+        for (size_t j = 0; j < chunk.size(); ++j) chunk[j] = static_cast<char>((sent + j) % 251);
+        ssize_t n = ::send(backend[0], chunk.data(), chunk.size(), MSG_DONTWAIT);
+        if (n > 0) sent += n;
+        loop.loopOnce(0);
+    }
+    CHECK(relay->backendReadPaused());
+    CHECK(relay->pendingToClient() >= StreamRelay::kHighWaterMark);
+
+    // 暂停期间后端再写也不会被读进用户态缓冲
+    size_t pausedPending = relay->pendingToClient();
+    for (int i = 0; i < 3; ++i) {
+        for (size_t j = 0; j < chunk.size(); ++j) chunk[j] = static_cast<char>((sent + j) % 251);
+        ssize_t n = ::send(backend[0], chunk.data(), chunk.size(), MSG_DONTWAIT);
+        if (n > 0) sent += n;
+        loop.loopOnce(10);
+    }
+    CHECK(relay->pendingToClient() == pausedPending);
+
+    // 客户端逐步读取：仍处于暂停时积压必须不低于低水位，恢复时已回落到低水位以下
+    size_t received = 0;
+    bool inOrder = true;
+    char buf[16384];
+    for (int i = 0; i < 10000 && relay->backendReadPaused(); ++i) {
+        ssize_t n = ::recv(client[0], buf, sizeof(buf), MSG_DONTWAIT);
+        for (ssize_t j = 0; j < n; ++j) inOrder &= buf[j] == static_cast<char>((received + j) % 251);
+        if (n > 0) received += n;
+        loop.loopOnce(0);
+        if (relay->backendReadPaused()) CHECK(relay->pendingToClient() >= StreamRelay::kLowWaterMark);
+    }
+    CHECK(!relay->backendReadPaused());
+    CHECK(relay->pendingToClient() < StreamRelay::kLowWaterMark);
+
+    // 后端写完关闭：剩余数据全部按序送达
+    ::close(backend[0]);
+    for (int i = 0; i < 100000; ++i) {
+        ssize_t n = ::recv(client[0], buf, sizeof(buf), MSG_DONTWAIT);
+        if (n == 0) break;
+        for (ssize_t j = 0; j < n; ++j) inOrder &= buf[j] == static_cast<char>((received + j) % 251);
+        if (n > 0) received += n;
+        loop.loopOnce(0);
+    }
+    CHECK(inOrder);
+    CHECK(received == sent);
+    ::close(client[0]);
+}
+
+// 客户端发完请求后 shutdown(SHUT_WR)：后端读到请求和 EOF，之后写出的响应仍完整送达客户端，
+// 后端关闭且数据送达后客户端才看到 EOF
+static void testClientHalfClose() {
+    int client[2], backend[2];
+    makePair(client);
+    makePair(backend);
+
+    EventLoop loop;
+    StreamRelay* relay = new StreamRelay(&loop, client[1], backend[1]);
+    relay->start();
+
+    const std::string request = "POST /v1/embeddings HTTP/1.0\r\nContent-Length: 2\r\n\r\n{}";
+    ::send(client[0], request.data(), request.size(), 0);
+    ::shutdown(client[0], SHUT_WR);
+    for (int i = 0; i < 5; ++i) loop.loopOnce(10);
+
+    CHECK(drain(backend[0]) == request);
+    char c;
+    CHECK(::recv(backend[0], &c, 1, MSG_DONTWAIT) == 0); // 后端看到请求结束
+
+    // 后端在客户端半关闭之后才开始回包：逐块送达，连接保持
+    std::string expected, received;
+    for (const std::string& chunk : {std::string("HTTP/1.0 200 OK\r\n\r\n"), std::string("data: a\n\n"),
+                                     std::string("data: b\n\n")}) {
+        ::send(backend[0], chunk.data(), chunk.size(), 0);
+        expected += chunk;
+        loop.loopOnce(10);
+        received += drain(client[0]);
+        CHECK(received == expected);
+    }
+    CHECK(::recv(client[0], &c, 1, MSG_DONTWAIT) == -1 && errno == EAGAIN); // 尚未关闭
+
+    ::close(backend[0]);
+    for (int i = 0; i < 5; ++i) loop.loopOnce(10);
+    CHECK(::recv(client[0], &c, 1, MSG_DONTWAIT) == 0);
+    ::close(client[0]);
+}
+
+int main() {
+    testChunksForwardedInOrder();
+    testBackpressurePauseAndResume();
+    testClientHalfClose();
+    return TEST_RESULT();
+}
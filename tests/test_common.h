@@ -0,0 +1,18 @@
+// test_common.h
+#pragma once
+#include <iostream>
+
+// 极简断言：失败时打印位置并计数，main 最后用 TEST_RESULT() 返回退出码给 ctest
+inline int g_test_failures = 0;
+
+#define CHECK(cond)                                                                 \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            std::cout << "[FAIL] " << __FILE__ << ":" << __LINE__ << "  " #cond << std::endl; \
+            ++g_test_failures;                                                      \
+        }                                                                           \
+    } while (0)
+
+#define TEST_RESULT()                                                               \
+    (g_test_failures == 0 ? (std::cout << "[PASS] " << __FILE__ << std::endl, 0)    \
+                          : (std::cout << g_test_failures << " 项失败" << std::endl, 1))
@@ -0,0 +1,231 @@
+// tls_connection_test.cpp
+// 用进程内生成的自签名证书在回环 TCP 上驱动 TlsConnection：
+// 握手、解密请求、send + sendFile (大文件触发 EPOLLOUT 续写) 的响应按序到达、
+// 第二次连接走会话复用、kTLS 默认关闭，打开后 (内核不支持时自动回退) 响应依旧正确。
+// 没有 OpenSSL 时整个测试跳过 (返回 77)
+#include "test_common.h"
+
+#ifdef GATEWAY_WITH_TLS
+#include "TlsTerminator.h"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+static std::string g_cert;
+static std::string g_key;
+static std::string g_file;
+static const size_t kFileSize = 512 * 1024;
+static const off_t kFileOffset = 100;
+
+// 生成 P-256 自签名证书和私钥 (PEM)
+static bool makeSelfSignedCert() {
+    EVP_PKEY* key = nullptr;
+    EVP_PKEY_CTX* pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+    bool ok = pctx && EVP_PKEY_keygen_init(pctx) == 1 &&
+              EVP_PKEY_CTX_set_ec_paramgen_curve_nid(pctx, NID_X9_62_prime256v1) == 1 &&
+              EVP_PKEY_keygen(pctx, &key) == 1;
+    EVP_PKEY_CTX_free(pctx);
+    if (!ok) return false;
+
+    X509* cert = X509_new();
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    ok = X509_sign(cert, key, EVP_sha256()) > 0;
+
+    FILE* certOut = ok ? fopen(g_cert.c_str(), "w") : nullptr;
+    FILE* keyOut = ok ? fopen(g_key.c_str(), "w") : nullptr;
+    ok = certOut && keyOut && PEM_write_X509(certOut, cert) == 1 &&
+         PEM_write_PrivateKey(keyOut, key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+    if (certOut) fclose(certOut);
+    if (keyOut) fclose(keyOut);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return ok;
+}
+
+static std::string fileContent() {
+    std::string data(kFileSize, '\0');
+    for (size_t i = 0; i < kFileSize; ++i) data[i] = static_cast<char>(i % 251);
+    return data;
+}
+
+// 回环 TCP 上建一对已连接的 socket
+static void connectedPair(int* serverFd, int* clientFd) {
+    int listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ::bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    ::listen(listenFd, 1);
+    socklen_t len = sizeof(addr);
+    ::getsockname(listenFd, reinterpret_cast<sockaddr*>(&addr), &len);
+    *clientFd = ::socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(::connect(*clientFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    *serverFd = ::accept(listenFd, nullptr, nullptr);
+    ::close(listenFd);
+}
+
+// 阻塞式客户端：握手、发请求、晚一点再读 (让服务端写满 socket 缓冲)，读完整个响应后关闭
+struct Client {
+    SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+    SSL_SESSION* session = nullptr; // 上一次连接拿到的会话
+    bool reused = false;
+    std::string response;
+
+    ~Client() {
+        if (session) SSL_SESSION_free(session);
+        SSL_CTX_free(ctx);
+    }
+
+    void run(int fd, const std::string& request, size_t expected) {
+        SSL* ssl = SSL_new(ctx);
+        SSL_set_fd(ssl, fd);
+        if (session) SSL_set_session(ssl, session);
+        response.clear();
+        if (SSL_connect(ssl) == 1) {
+            reused = SSL_session_reused(ssl) == 1;
+            SSL_write(ssl, request.data(), static_cast<int>(request.size()));
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            char buf[16384];
+            while (response.size() < expected) {
+                int n = SSL_read(ssl, buf, sizeof(buf));
+                if (n <= 0) break;
+                response.append(buf, n);
+            }
+            if (session) SSL_SESSION_free(session);
+            session = SSL_get1_session(ssl); // TLS 1.3 的 ticket 在握手后随数据下发
+            SSL_shutdown(ssl);
+        }
+        SSL_free(ssl);
+        ::close(fd);
+    }
+};
+
+// 服务端：收到请求后回 响应头 + 文件区间 + 结尾标记，三段必须按序到达
+struct Server {
+    EventLoop loop;
+    TlsServerContext ctx;
+    int fileFd = ::open(g_file.c_str(), O_RDONLY);
+    std::vector<std::string> requests;
+    bool ktlsSend = false;
+
+    ~Server() { ::close(fileFd); }
+
+    // 服务一个连接：客户端线程跑完后再多转几轮，让连接对象走完关闭和释放
+    void serve(Client& client, const std::string& request, size_t expected) {
+        int serverFd, clientFd;
+        connectedPair(&serverFd, &clientFd);
+        std::atomic<bool> done(false);
+        std::thread peer([&]() {
+            client.run(clientFd, request, expected);
+            done = true;
+        });
+
+        (new TlsConnection(&loop, &ctx, serverFd, [this](TlsConnection* conn, const std::string& data) {
+            requests.push_back(data);
+            ktlsSend = conn->ktlsSendEnabled();
+            const std::string header = "HTTP/1.1 200 OK\r\n\r\n";
+            conn->send(header.data(), header.size());
+            conn->sendFile(nullptr, fileFd, kFileOffset, kFileSize - kFileOffset);
+            conn->send("END", 3);
+        }))->start();
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!done && std::chrono::steady_clock::now() < deadline) loop.loopOnce(10);
+        peer.join();
+        for (int i = 0; i < 5; ++i) loop.loopOnce(10);
+    }
+};
+
+static std::string expectedResponse() {
+    return "HTTP/1.1 200 OK\r\n\r\n" + fileContent().substr(kFileOffset) + "END";
+}
+
+static void testHandshakeSendAndResume() {
+    Server server;
+    CHECK(server.ctx.init(g_cert.c_str(), g_key.c_str()));
+    const std::string request = "GET /static/model.bin HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    const std::string expected = expectedResponse();
+
+    Client client;
+    server.serve(client, request, expected.size());
+    CHECK(server.requests.size() == 1 && server.requests[0] == request);
+    CHECK(client.response == expected);
+    CHECK(!client.reused);
+    CHECK(!server.ktlsSend); // 没有显式打开时不走 kTLS
+    CHECK(server.ctx.fullHandshakes() == 1);
+
+    // 带着上次的会话再连一次：简短握手
+    server.serve(client, request, expected.size());
+    CHECK(client.response == expected);
+    CHECK(client.reused);
+    CHECK(server.ctx.resumedHandshakes() == 1);
+    CHECK(server.ctx.fullHandshakes() == 1);
+}
+
+static void testKtlsOptIn() {
+    Server server;
+    CHECK(server.ctx.init(g_cert.c_str(), g_key.c_str(), true));
+    const std::string expected = expectedResponse();
+
+    Client client;
+    server.serve(client, "GET / HTTP/1.1\r\n\r\n", expected.size());
+    // 内核有 tls 模块时 sendFile 走 SSL_sendfile，否则留在用户态加密；两种情况响应都必须完整
+    CHECK(client.response == expected);
+    std::cout << "[TLS test] kTLS 发送: " << (server.ktlsSend ? "开" : "关 (内核不支持，已回退)") << std::endl;
+}
+
+int main() {
+    std::string base = "/tmp/tls_connection_test_" + std::to_string(::getpid());
+    g_cert = base + ".crt";
+    g_key = base + ".key";
+    g_file = base + ".bin";
+    if (!makeSelfSignedCert()) {
+        std::cout << "[SKIP] 无法生成自签名证书" << std::endl;
+        return 77;
+    }
+    std::string content = fileContent();
+    int fd = ::open(g_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    CHECK(::write(fd, content.data(), content.size()) == static_cast<ssize_t>(content.size()));
+    ::close(fd);
+    signal(SIGPIPE, SIG_IGN);
+
+    testHandshakeSendAndResume();
+    testKtlsOptIn();
+
+    ::unlink(g_cert.c_str());
+    ::unlink(g_key.c_str());
+    ::unlink(g_file.c_str());
+    return TEST_RESULT();
+}
+
+#else
+
+#include <iostream>
+
+int main() {
+    std::cout << "[SKIP] 未找到 OpenSSL，跳过 TLS 测试" << std::endl;
+    return 77;
+}
+
+#endif
@@ -0,0 +1,73 @@
+// transfer_utils_test.cpp
+// 验证 TransferUtils::sendFileZeroCopy：对端正常接收时整个文件发完；
+// 对端一直不读时在超时后返回 -1 (errno = ETIMEDOUT)，不会永远卡住
+#include "test_common.h"
+#include "MemoryManager.h"
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static std::string g_path;
+
+static void writeFile(size_t size) {
+    std::vector<char> data(size);
+    for (size_t i = 0; i < size; ++i) data[i] = static_cast<char>(i % 251);
+    int fd = ::open(g_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    CHECK(::write(fd, data.data(), data.size()) == static_cast<ssize_t>(data.size()));
+    ::close(fd);
+}
+
+static void testSendsWholeFile() {
+    const size_t kSize = 4 * 1024 * 1024;
+    writeFile(kSize);
+    int fds[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    ::fcntl(fds[1], F_SETFL, ::fcntl(fds[1], F_GETFL, 0) | O_NONBLOCK);
+
+    size_t received = 0;
+    bool inOrder = true;
+    std::thread reader([&]() {
+        char buf[65536];
+        ssize_t n;
+        while ((n = ::read(fds[0], buf, sizeof(buf))) > 0) {
+            for (ssize_t i = 0; i < n; ++i) inOrder &= buf[i] == static_cast<char>((received + i) % 251);
+            received += n;
+        }
+    });
+    CHECK(TransferUtils::sendFileZeroCopy(fds[1], g_path.c_str(), 5000) == static_cast<ssize_t>(kSize));
+    ::close(fds[1]);
+    reader.join();
+    ::close(fds[0]);
+    CHECK(received == kSize);
+    CHECK(inOrder);
+}
+
+static void testStalledPeerTimesOut() {
+    writeFile(4 * 1024 * 1024);
+    int fds[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    ::fcntl(fds[1], F_SETFL, ::fcntl(fds[1], F_GETFL, 0) | O_NONBLOCK);
+
+    // 对端不读：socket 缓冲写满后每次等待都超时
+    auto start = std::chrono::steady_clock::now();
+    errno = 0;
+    CHECK(TransferUtils::sendFileZeroCopy(fds[1], g_path.c_str(), 200) == -1);
+    CHECK(errno == ETIMEDOUT);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    CHECK(elapsed >= std::chrono::milliseconds(150));
+    CHECK(elapsed < std::chrono::seconds(2));
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+int main() {
+    g_path = "/tmp/transfer_utils_test_" + std::to_string(::getpid());
+    testSendsWholeFile();
+    testStalledPeerTimesOut();
+    ::unlink(g_path.c_str());
+    return TEST_RESULT();
+}
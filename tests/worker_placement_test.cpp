@@ -0,0 +1,106 @@
+// worker_placement_test.cpp
+// 验证 CPU 列表解析 (区间、空白、非法片段)、CBPF 分发要求的恒等绑核判断，
+// 以及 ConnectionSteering 在假拓扑上的分发顺序：同核 Worker -> 同 NUMA 节点轮流 -> 全局轮询
+#include "test_common.h"
+#include "WorkerPlacement.h"
+#include <set>
+#include <vector>
+
+static void testParseCpuList() {
+    CHECK(WorkerPlacement::parseCpuList(nullptr).empty());
+    CHECK(WorkerPlacement::parseCpuList("").empty());
+    CHECK((WorkerPlacement::parseCpuList("3") == std::vector<int>{3}));
+    CHECK((WorkerPlacement::parseCpuList("0,2,4-7") == std::vector<int>{0, 2, 4, 5, 6, 7}));
+    CHECK((WorkerPlacement::parseCpuList(" 1 , 3-4 ,") == std::vector<int>{1, 3, 4}));
+    CHECK((WorkerPlacement::parseCpuList("5-5") == std::vector<int>{5}));
+
+    // 非法片段整段忽略，其余照常生效
+    CHECK((WorkerPlacement::parseCpuList("x,1,2y,3-,-4,5-2,6--7,8") == std::vector<int>{1, 8}));
+    CHECK((WorkerPlacement::parseCpuList("1-3x,0x2,+1,9") == std::vector<int>{9}));
+    CHECK(WorkerPlacement::parseCpuList(",,,").empty());
+    // 超出 CPU_SETSIZE 的编号和区间不会生成海量条目
+    CHECK(WorkerPlacement::parseCpuList("0-99999999").empty());
+    CHECK(WorkerPlacement::parseCpuList("4096").empty());
+    CHECK((WorkerPlacement::parseCpuList("2,99999999999999999999") == std::vector<int>{2}));
+    CHECK(!WorkerPlacement::pinCurrentThread(-1));
+    CHECK(!WorkerPlacement::pinCurrentThread(CPU_SETSIZE));
+}
+
+static void testIsIdentityCpuList() {
+    CHECK(WorkerPlacement::isIdentityCpuList({0}));
+    CHECK(WorkerPlacement::isIdentityCpuList({0, 1, 2, 3}));
+    CHECK(WorkerPlacement::isIdentityCpuList(WorkerPlacement::parseCpuList("0-3")));
+    CHECK(!WorkerPlacement::isIdentityCpuList({}));
+    CHECK(!WorkerPlacement::isIdentityCpuList({1, 2, 3}));
+    CHECK(!WorkerPlacement::isIdentityCpuList({0, 2, 4}));
+    CHECK(!WorkerPlacement::isIdentityCpuList({1, 0}));
+}
+
+// 8 个 CPU：0-3 在节点 0，4-7 在节点 1；nodeless 时所有 CPU 都查不到节点
+static CpuTopology fakeTopology(bool nodeless = false) {
+    CpuTopology topology;
+    topology.cpuCount = 8;
+    topology.nodeOf = [nodeless](int cpu) { return nodeless ? -1 : cpu / 4; };
+    return topology;
+}
+
+static void testSteeringFallbackOrder() {
+    // Worker 0 在 CPU 0，Worker 1 在 CPU 1 (都在节点 0)，Worker 2 在 CPU 4 (节点 1)
+    ConnectionSteering steering({0, 1, 4}, 3, fakeTopology());
+
+    // 1. 收包 CPU 上就有 Worker
+    CHECK(steering.pickWorkerForCpu(0) == 0);
+    CHECK(steering.pickWorkerForCpu(1) == 1);
+    CHECK(steering.pickWorkerForCpu(4) == 2);
+
+    // 2. 同节点上的 Worker：节点 0 的 CPU 2、3 在 Worker 0、1 之间轮流，节点 1 全部落到 Worker 2
+    CHECK(steering.pickWorkerForCpu(2) == 0);
+    CHECK(steering.pickWorkerForCpu(3) == 1);
+    for (int cpu = 5; cpu < 8; ++cpu) CHECK(steering.pickWorkerForCpu(cpu) == 2);
+    // 表是固定的：同一个 CPU 多次查询结果不变
+    CHECK(steering.pickWorkerForCpu(2) == 0);
+
+    // 3. 未知 CPU / 超出范围：全局轮询
+    std::vector<int> picks;
+    for (int i = 0; i < 6; ++i) picks.push_back(steering.pickWorkerForCpu(i % 2 ? -1 : 100));
+    CHECK((picks == std::vector<int>{0, 1, 2, 0, 1, 2}));
+}
+
+static void testSteeringWithoutNumaInfo() {
+    // 查不到节点时只有绑核的 CPU 命中，其余 CPU 轮询
+    ConnectionSteering steering({0, 1}, 2, fakeTopology(true));
+    CHECK(steering.pickWorkerForCpu(0) == 0);
+    CHECK(steering.pickWorkerForCpu(1) == 1);
+    std::set<int> picked;
+    for (int i = 0; i < 4; ++i) picked.insert(steering.pickWorkerForCpu(5));
+    CHECK((picked == std::set<int>{0, 1}));
+
+    // 节点 1 上没有 Worker：该节点的 CPU 同样退化为轮询
+    ConnectionSteering nodeZeroOnly({0}, 2, fakeTopology());
+    CHECK(nodeZeroOnly.pickWorkerForCpu(3) == 0);
+    picked.clear();
+    for (int i = 0; i < 4; ++i) picked.insert(nodeZeroOnly.pickWorkerForCpu(6));
+    CHECK((picked == std::set<int>{0, 1}));
+}
+
+static void testSteeringIgnoresBadCpus() {
+    // 超出 CPU 总数的绑核配置、多于 Worker 数的 CPU 都不进表
+    ConnectionSteering steering({9, 2, 3}, 2, fakeTopology());
+    CHECK(steering.pickWorkerForCpu(2) == 1);
+    for (int cpu = 0; cpu < 4; ++cpu) CHECK(steering.pickWorkerForCpu(cpu) == 1);
+
+    // 没有绑核配置：全部轮询
+    ConnectionSteering none({}, 3, fakeTopology());
+    std::vector<int> picks;
+    for (int i = 0; i < 3; ++i) picks.push_back(none.pickWorkerForCpu(0));
+    CHECK((picks == std::vector<int>{0, 1, 2}));
+}
+
+int main() {
+    testParseCpuList();
+    testIsIdentityCpuList();
+    testSteeringFallbackOrder();
+    testSteeringWithoutNumaInfo();
+    testSteeringIgnoresBadCpus();
+    return TEST_RESULT();
+}